@@ -0,0 +1,760 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <bit_plan.hpp>
+#include <common_defs.hpp>
+#include <database.hpp>
+#include <decode_subset.hpp>
+#include <e2e.hpp>
+#include <message_codec.hpp>
+#include <scaling_kernels.hpp>
+#include <struct_binding.hpp>
+
+using AS::CAN::DbcLoader::BitPlan;
+using AS::CAN::DbcLoader::BitPlanBackend;
+using AS::CAN::DbcLoader::BitPlanKernels;
+using AS::CAN::DbcLoader::CanFrame;
+using AS::CAN::DbcLoader::ChecksumType;
+using AS::CAN::DbcLoader::Crc8;
+using AS::CAN::DbcLoader::Database;
+using AS::CAN::DbcLoader::DecodeMode;
+using AS::CAN::DbcLoader::DecodeSubset;
+using AS::CAN::DbcLoader::E2EStatus;
+using AS::CAN::DbcLoader::FRAME_PADDING;
+using AS::CAN::DbcLoader::FrameOrder;
+using AS::CAN::DbcLoader::MemberType;
+using AS::CAN::DbcLoader::MAX_COLUMN_CHUNK;
+using AS::CAN::DbcLoader::MAX_FRAME_LENGTH;
+using AS::CAN::DbcLoader::PaddedFrame;
+using AS::CAN::DbcLoader::MessageCodec;
+using AS::CAN::DbcLoader::MessageTranscoder;
+using AS::CAN::DbcLoader::MixedBatchOutput;
+using AS::CAN::DbcLoader::ScalingKernels;
+using AS::CAN::DbcLoader::SignalHandle;
+using AS::CAN::DbcLoader::SimdLevel;
+using AS::CAN::DbcLoader::StructBinding;
+using AS::CAN::DbcLoader::getBitPlanKernels;
+using AS::CAN::DbcLoader::getScalingKernels;
+
+static const size_t FRAME_COUNT = 1000000;
+// Frames per decodeBatch() call. Columns for the whole batch stay in
+// cache, as they would when a consumer processes one batch at a time.
+static const size_t BATCH_SIZE = 1024;
+
+// One classic CAN message and one CAN FD message with a mix of
+// byte orders, signs and widths.
+static std::string buildDbc()
+{
+  std::ostringstream dbc;
+
+  dbc << "VERSION \"\"\n\nBS_:\n\nBU_: ECU\n\n";
+
+  dbc << "BO_ 256 CLASSIC: 8 ECU\n";
+  dbc << " SG_ SPEED : 0|16@1+ (0.01,0) [0|655.35] \"km/h\" ECU\n";
+  dbc << " SG_ ACCEL : 19|12@0- (0.01,0) [-20.48|20.47] \"m/s2\" ECU\n";
+  dbc << " SG_ TORQUE : 32|12@1- (0.5,-100) [-1124|923.5] \"Nm\" ECU\n";
+  dbc << " SG_ GEAR : 20|4@1+ (1,0) [0|15] \"\" ECU\n";
+  dbc << " SG_ STATUS : 44|4@1+ (1,0) [0|15] \"\" ECU\n";
+  dbc << " SG_ ANGLE : 55|16@0- (0.1,0) [-3276.8|3276.7] \"deg\" ECU\n\n";
+
+  dbc << "BO_ 512 FD: 64 ECU\n";
+
+  for (unsigned int i = 0; i < 32; ++i) {
+    unsigned int start_bit = i * 16;
+
+    if (i % 2 == 0) {
+      dbc << " SG_ CELL_" << i << " : " << start_bit << "|13@1+ (0.001,0) [0|8.191] \"V\" ECU\n";
+    } else {
+      // Motorola start bit is the MSB of the 16-bit slot
+      dbc << " SG_ CELL_" << i << " : " << start_bit + 7 << "|13@0- (0.1,0) [-409.6|409.5] \"C\" ECU\n";
+    }
+  }
+
+  dbc << "\n";
+
+  return dbc.str();
+}
+
+template<typename Function>
+static double framesPerSecond(size_t frame_count, Function function)
+{
+  auto start = std::chrono::steady_clock::now();
+  function();
+  auto end = std::chrono::steady_clock::now();
+
+  return frame_count / std::chrono::duration<double>(end - start).count();
+}
+
+static void runBenchmark(const MessageCodec & codec)
+{
+  const size_t stride = codec.getLength();
+  std::vector<uint8_t> frames(FRAME_COUNT * stride);
+  std::mt19937 rng(codec.getId());
+
+  for (auto & byte : frames) {
+    byte = static_cast<uint8_t>(rng());
+  }
+
+  double checksum = 0.0;
+  MessageCodec::Output output;
+  MessageCodec::BatchOutput batch_output;
+
+  double single_rate = framesPerSecond(FRAME_COUNT, [&]() {
+    for (size_t i = 0; i < FRAME_COUNT; ++i) {
+      codec.decode(frames.data() + i * stride, stride, output);
+      checksum += output.values[0];
+    }
+  });
+
+  // Warm up so the batch output buffers are already allocated
+  codec.decodeBatch(frames.data(), BATCH_SIZE, stride, batch_output);
+
+  double batch_rate = framesPerSecond(FRAME_COUNT, [&]() {
+    for (size_t i = 0; i < FRAME_COUNT; i += BATCH_SIZE) {
+      codec.decodeBatch(frames.data() + i * stride, std::min(BATCH_SIZE, FRAME_COUNT - i), stride, batch_output);
+      checksum += batch_output.values[0];
+    }
+  });
+
+  size_t violated_frames = 0;
+
+  double validated_rate = framesPerSecond(FRAME_COUNT, [&]() {
+    for (size_t i = 0; i < FRAME_COUNT; i += BATCH_SIZE) {
+      codec.decodeBatch(frames.data() + i * stride, std::min(BATCH_SIZE, FRAME_COUNT - i), stride, batch_output);
+      violated_frames += codec.validateBatch(batch_output);
+    }
+  });
+
+  std::cout << "Message " << codec.getId() << " (" << stride << " bytes, ";
+  std::cout << codec.getSignalCount() << " signals):" << std::endl;
+  std::cout << "  decode:      " << static_cast<uint64_t>(single_rate) << " frames/s" << std::endl;
+  // A typical consumer only wants a few of the signals
+  std::vector<SignalHandle> subscribed(std::min<size_t>(4, codec.getSignalCount()));
+
+  for (size_t i = 0; i < subscribed.size(); ++i) {
+    subscribed[i].message_index = codec.getMessageIndex();
+    subscribed[i].slot = static_cast<uint32_t>(i);
+  }
+
+  std::cout << "  decodeBatch: " << static_cast<uint64_t>(batch_rate) << " frames/s" << std::endl;
+  std::cout << "  decodeBatch + validateBatch: " << static_cast<uint64_t>(validated_rate);
+  std::cout << " frames/s (" << violated_frames << " frames out of range)" << std::endl;
+
+  const std::pair<DecodeMode, const char *> modes[] = {
+    {DecodeMode::PHYSICAL, "PHYSICAL"},
+    {DecodeMode::RAW, "RAW"},
+    {DecodeMode::FIXED_POINT, "FIXED_POINT"}
+  };
+
+  for (const auto & mode : modes) {
+    DecodeSubset subset(codec, subscribed, mode.first);
+
+    double subset_rate = framesPerSecond(FRAME_COUNT, [&]() {
+      for (size_t i = 0; i < FRAME_COUNT; ++i) {
+        subset.decode(frames.data() + i * stride, stride, output);
+        checksum += static_cast<double>(output.raw_values[0]);
+      }
+    });
+
+    std::cout << "  DecodeSubset (" << subscribed.size() << " signals, " << mode.second << "): ";
+    std::cout << static_cast<uint64_t>(subset_rate) << " frames/s" << std::endl;
+  }
+
+  std::cout << "  (checksum " << checksum << ")" << std::endl;
+}
+
+// Compares decode() with decodeDelta() on a stream where consecutive
+// frames only differ in one byte, as is typical on a real bus. Each
+// decoded signal is then "published" by reading its physical value.
+static void runDeltaBenchmark(MessageTranscoder & xcoder, size_t length)
+{
+  std::vector<uint8_t> frames(FRAME_COUNT * length);
+  std::mt19937 rng(static_cast<unsigned int>(length));
+
+  for (auto & byte : frames) {
+    byte = static_cast<uint8_t>(rng());
+  }
+
+  for (size_t i = 1; i < FRAME_COUNT; ++i) {
+    std::memcpy(frames.data() + i * length, frames.data() + (i - 1) * length, length);
+    frames[i * length + rng() % length] = static_cast<uint8_t>(rng());
+  }
+
+  size_t changed_count = 0;
+  double checksum = 0.0;
+  std::vector<uint32_t> changed_slots;
+  std::vector<SignalHandle> handles(xcoder.getMessageDef()->getSignals().size());
+
+  for (size_t slot = 0; slot < handles.size(); ++slot) {
+    handles[slot].message_index = xcoder.getMessageIndex();
+    handles[slot].slot = static_cast<uint32_t>(slot);
+  }
+
+  double full_rate = framesPerSecond(FRAME_COUNT, [&]() {
+    for (size_t i = 0; i < FRAME_COUNT; ++i) {
+      xcoder.decode(frames.data() + i * length, length);
+
+      for (const auto & handle : handles) {
+        checksum += xcoder.getSignal(handle)->getValue();
+      }
+    }
+  });
+
+  xcoder.resetDelta();
+
+  double delta_rate = framesPerSecond(FRAME_COUNT, [&]() {
+    for (size_t i = 0; i < FRAME_COUNT; ++i) {
+      xcoder.decodeDelta(frames.data() + i * length, length, changed_slots);
+      changed_count += changed_slots.size();
+
+      for (auto slot : changed_slots) {
+        checksum += xcoder.getSignal(handles[slot])->getValue();
+      }
+    }
+  });
+
+  std::cout << "  MessageTranscoder::decode:      " << static_cast<uint64_t>(full_rate);
+  std::cout << " frames/s" << std::endl;
+  std::cout << "  MessageTranscoder::decodeDelta: " << static_cast<uint64_t>(delta_rate);
+  std::cout << " frames/s (" << static_cast<double>(changed_count) / FRAME_COUNT;
+  std::cout << " changed signals/frame)" << std::endl;
+  std::cout << "  (checksum " << checksum << ")" << std::endl;
+}
+
+// Transmit side: each frame updates two signals and leaves the rest
+// at their start values
+static void runEncodeBenchmark(MessageTranscoder & xcoder, size_t length)
+{
+  std::vector<uint8_t> frames(FRAME_COUNT * length);
+  SignalHandle first_signal;
+  SignalHandle second_signal;
+  first_signal.message_index = xcoder.getMessageIndex();
+  first_signal.slot = 0;
+  second_signal.message_index = xcoder.getMessageIndex();
+  second_signal.slot = 1;
+
+  auto encode_frames = [&]() {
+    for (size_t i = 0; i < FRAME_COUNT; ++i) {
+      xcoder.getSignal(first_signal)->setRawValue(static_cast<int64_t>(i));
+      xcoder.getSignal(second_signal)->setRawValue(static_cast<int64_t>(i >> 8));
+      xcoder.encode(frames.data() + i * length, length);
+    }
+  };
+
+  xcoder.resetToTemplate();
+  double template_rate = framesPerSecond(FRAME_COUNT, encode_frames);
+
+  // A decoded frame replaces the start values, so every signal is encoded
+  xcoder.decode(frames.data(), length);
+  double full_rate = framesPerSecond(FRAME_COUNT, encode_frames);
+
+  std::cout << "  MessageTranscoder::encode, 2 signals set: " << static_cast<uint64_t>(template_rate);
+  std::cout << " frames/s from the template, " << static_cast<uint64_t>(full_rate);
+  std::cout << " frames/s after a decode" << std::endl;
+}
+
+// Compares the bit extraction backends on their own, without scaling.
+// Returns false if the backends disagree.
+static bool runExtractionBenchmark(const MessageCodec & codec)
+{
+  const std::vector<BitPlan> & plans = codec.getLayout()->getPlans();
+  const size_t length = codec.getLength();
+  const size_t pitch = FRAME_PADDING + MAX_FRAME_LENGTH;
+  std::vector<uint8_t> frames(MAX_COLUMN_CHUNK * pitch + FRAME_PADDING, 0);
+  std::mt19937 rng(codec.getId());
+
+  // One chunk of padded frames, decoded repeatedly so the benchmark
+  // measures extraction rather than memory bandwidth
+  for (size_t i = 0; i < MAX_COLUMN_CHUNK; ++i) {
+    for (size_t byte = 0; byte < length; ++byte) {
+      frames[i * pitch + FRAME_PADDING + byte] = static_cast<uint8_t>(rng());
+    }
+  }
+
+  const size_t repeats = FRAME_COUNT / MAX_COLUMN_CHUNK;
+  std::vector<int64_t> expected;
+  bool identical = true;
+
+  std::cout << "Bit extraction, message " << codec.getId() << " (" << length << " bytes, ";
+  std::cout << plans.size() << " signals, selected: ";
+  std::cout << (getBitPlanKernels().backend == BitPlanBackend::BMI2 ? "BMI2" : "shift/mask");
+  std::cout << "):" << std::endl;
+
+  for (auto backend : {BitPlanBackend::SHIFT_MASK, BitPlanBackend::BMI2}) {
+    const char * name = (backend == BitPlanBackend::BMI2 ? "BMI2" : "shift/mask");
+    const BitPlanKernels * kernels = getBitPlanKernels(backend);
+
+    if (kernels == nullptr) {
+      std::cout << "  " << name << ": not supported" << std::endl;
+      continue;
+    }
+
+    std::vector<int64_t> raw(plans.size() * MAX_COLUMN_CHUNK);
+
+    double frame_rate = framesPerSecond(repeats * MAX_COLUMN_CHUNK, [&]() {
+      for (size_t repeat = 0; repeat < repeats; ++repeat) {
+        for (size_t i = 0; i < MAX_COLUMN_CHUNK; ++i) {
+          kernels->extractFrame(
+            plans.data(), plans.size(), frames.data() + i * pitch, raw.data() + i * plans.size());
+        }
+      }
+    });
+
+    std::vector<int64_t> columns(plans.size() * MAX_COLUMN_CHUNK);
+
+    double column_rate = framesPerSecond(repeats * MAX_COLUMN_CHUNK, [&]() {
+      for (size_t repeat = 0; repeat < repeats; ++repeat) {
+        for (size_t slot = 0; slot < plans.size(); ++slot) {
+          kernels->extractColumn(
+            plans[slot], frames.data(), pitch, MAX_COLUMN_CHUNK,
+            columns.data() + slot * MAX_COLUMN_CHUNK);
+        }
+      }
+    });
+
+    if (expected.empty()) {
+      expected = raw;
+    }
+
+    bool backend_identical = (raw == expected);
+
+    for (size_t slot = 0; slot < plans.size(); ++slot) {
+      for (size_t i = 0; i < MAX_COLUMN_CHUNK; ++i) {
+        backend_identical = backend_identical &&
+          columns[slot * MAX_COLUMN_CHUNK + i] == expected[i * plans.size() + slot];
+      }
+    }
+
+    std::cout << "  " << name << ": " << static_cast<uint64_t>(frame_rate) << " frames/s per frame, ";
+    std::cout << static_cast<uint64_t>(column_rate) << " frames/s by column, ";
+    std::cout << (backend_identical ? "identical" : "MISMATCH") << std::endl;
+
+    identical = identical && backend_identical;
+  }
+
+  return identical;
+}
+
+static const char * levelName(SimdLevel level)
+{
+  switch (level) {
+    case SimdLevel::SCALAR:
+      return "scalar";
+    case SimdLevel::SSE4_2:
+      return "SSE4.2";
+    case SimdLevel::AVX2:
+      return "AVX2";
+    case SimdLevel::AVX512:
+      return "AVX-512";
+  }
+
+  return "unknown";
+}
+
+// Runs every kernel set the CPU supports over the same columns and
+// checks the results are bit-identical to the scalar kernels.
+// Returns false on any mismatch.
+static bool runKernelBenchmark()
+{
+  const size_t count = FRAME_COUNT;
+  std::vector<int64_t> raw(count);
+  std::mt19937_64 rng(0);
+
+  for (size_t i = 0; i < count; ++i) {
+    // Mix of small and full-width values, both signs
+    raw[i] = static_cast<int64_t>(rng() >> (rng() % 64));
+
+    if (i % 2) {
+      raw[i] = -raw[i];
+    }
+  }
+
+  std::vector<double> expected_signed(count);
+  std::vector<double> expected_unsigned(count);
+  std::vector<double> values(count);
+  const ScalingKernels * scalar = getScalingKernels(SimdLevel::SCALAR);
+
+  scalar->scaleSigned(raw.data(), count, 0.1, -40.0, expected_signed.data());
+  scalar->clamp(expected_signed.data(), count, -1e15, 1e15);
+  scalar->scaleUnsigned(raw.data(), count, 0.001, 3.5, expected_unsigned.data());
+
+  std::vector<uint64_t> expected_masks(count, 0);
+  std::vector<uint64_t> masks(count);
+  scalar->flagRange(expected_signed.data(), count, -1e12, 1e12, 1, expected_masks.data(), 1);
+
+  bool identical = true;
+
+  std::cout << "Scaling kernels (best: " << levelName(getScalingKernels().level) << "):" << std::endl;
+
+  for (auto level : {SimdLevel::SCALAR, SimdLevel::SSE4_2, SimdLevel::AVX2, SimdLevel::AVX512}) {
+    const ScalingKernels * kernels = getScalingKernels(level);
+
+    if (kernels == nullptr) {
+      std::cout << "  " << levelName(level) << ": not supported" << std::endl;
+      continue;
+    }
+
+    double rate = framesPerSecond(count, [&]() {
+      kernels->scaleSigned(raw.data(), count, 0.1, -40.0, values.data());
+      kernels->clamp(values.data(), count, -1e15, 1e15);
+    });
+
+    bool level_identical =
+      std::memcmp(values.data(), expected_signed.data(), count * sizeof(double)) == 0;
+
+    kernels->scaleUnsigned(raw.data(), count, 0.001, 3.5, values.data());
+    level_identical = level_identical &&
+      std::memcmp(values.data(), expected_unsigned.data(), count * sizeof(double)) == 0;
+
+    std::fill(masks.begin(), masks.end(), 0);
+    kernels->flagRange(expected_signed.data(), count, -1e12, 1e12, 1, masks.data(), 1);
+    level_identical = level_identical && masks == expected_masks;
+
+    std::cout << "  " << levelName(level) << ": " << static_cast<uint64_t>(rate) << " values/s, ";
+    std::cout << (level_identical ? "bit-identical" : "MISMATCH") << std::endl;
+
+    identical = identical && level_identical;
+  }
+
+  return identical;
+}
+
+// The application-side struct for message 256
+struct VehicleStatus
+{
+  float speed;
+  float accel;
+  int16_t torque;
+  uint8_t gear;
+  uint8_t status;
+  double angle;
+};
+
+// Copying values field by field out of a MessageTranscoder by name
+// and out of an Output by slot, against a StructBinding writing the
+// struct directly. The copies truncate where the binding rounds.
+static void runBindingBenchmark(const MessageCodec & codec, MessageTranscoder & xcoder)
+{
+  const size_t stride = codec.getLength();
+  std::vector<uint8_t> frames(FRAME_COUNT * stride);
+  std::mt19937 rng(codec.getId());
+
+  for (auto & byte : frames) {
+    byte = static_cast<uint8_t>(rng());
+  }
+
+  const StructBinding binding(codec, sizeof(VehicleStatus), {
+    {"SPEED", offsetof(VehicleStatus, speed), MemberType::FLOAT},
+    {"ACCEL", offsetof(VehicleStatus, accel), MemberType::FLOAT},
+    {"TORQUE", offsetof(VehicleStatus, torque), MemberType::INT16},
+    {"GEAR", offsetof(VehicleStatus, gear), MemberType::UINT8},
+    {"STATUS", offsetof(VehicleStatus, status), MemberType::UINT8},
+    {"ANGLE", offsetof(VehicleStatus, angle), MemberType::DOUBLE}
+  });
+
+  const int slots[] = {
+    codec.getSlot("SPEED"), codec.getSlot("ACCEL"), codec.getSlot("TORQUE"),
+    codec.getSlot("GEAR"), codec.getSlot("STATUS"), codec.getSlot("ANGLE")
+  };
+
+  double checksum = 0.0;
+  MessageCodec::Output output;
+  VehicleStatus status;
+
+  double named_rate = framesPerSecond(FRAME_COUNT, [&]() {
+    for (size_t i = 0; i < FRAME_COUNT; ++i) {
+      xcoder.decode(frames.data() + i * stride, stride);
+      status.speed = static_cast<float>(xcoder.getSignal("SPEED")->getValue());
+      status.accel = static_cast<float>(xcoder.getSignal("ACCEL")->getValue());
+      status.torque = static_cast<int16_t>(xcoder.getSignal("TORQUE")->getValue());
+      status.gear = static_cast<uint8_t>(xcoder.getSignal("GEAR")->getValue());
+      status.status = static_cast<uint8_t>(xcoder.getSignal("STATUS")->getValue());
+      status.angle = xcoder.getSignal("ANGLE")->getValue();
+      checksum += status.speed + status.gear;
+    }
+  });
+
+  double copy_rate = framesPerSecond(FRAME_COUNT, [&]() {
+    for (size_t i = 0; i < FRAME_COUNT; ++i) {
+      codec.decode(frames.data() + i * stride, stride, output);
+      status.speed = static_cast<float>(output.values[slots[0]]);
+      status.accel = static_cast<float>(output.values[slots[1]]);
+      status.torque = static_cast<int16_t>(output.values[slots[2]]);
+      status.gear = static_cast<uint8_t>(output.values[slots[3]]);
+      status.status = static_cast<uint8_t>(output.values[slots[4]]);
+      status.angle = output.values[slots[5]];
+      checksum += status.speed + status.gear;
+    }
+  });
+
+  double binding_rate = framesPerSecond(FRAME_COUNT, [&]() {
+    for (size_t i = 0; i < FRAME_COUNT; ++i) {
+      binding.decode(frames.data() + i * stride, stride, status);
+      checksum += status.speed + status.gear;
+    }
+  });
+
+  std::cout << "Struct decode, message " << codec.getId() << ":" << std::endl;
+  std::cout << "  MessageTranscoder + copy by name: " << static_cast<uint64_t>(named_rate);
+  std::cout << " frames/s" << std::endl;
+  std::cout << "  MessageCodec + copy by slot: " << static_cast<uint64_t>(copy_rate) << " frames/s" << std::endl;
+  std::cout << "  StructBinding: " << static_cast<uint64_t>(binding_rate) << " frames/s" << std::endl;
+  std::cout << "  (checksum " << checksum << ")" << std::endl;
+}
+
+// Frames of every message interleaved at random, as they arrive from a
+// bus, with one in a hundred carrying an ID the database doesn't know.
+static void runMixedBenchmark(const Database & dbc)
+{
+  std::vector<CanFrame> frames(FRAME_COUNT);
+  std::mt19937 rng(1);
+
+  for (size_t i = 0; i < FRAME_COUNT; ++i) {
+    CanFrame & frame = frames[i];
+
+    if (rng() % 100 == 0) {
+      frame.id = 0x7FF;
+      frame.length = 8;
+    } else {
+      const MessageCodec & codec = *dbc.getCodecAt(rng() % dbc.getCodecCount());
+      frame.id = codec.getId();
+      frame.length = static_cast<uint8_t>(codec.getLength());
+    }
+
+    frame.timestamp = i;
+
+    for (auto & byte : frame.data) {
+      byte = static_cast<uint8_t>(rng());
+    }
+  }
+
+  double checksum = 0.0;
+  MessageCodec::Output output;
+
+  double single_rate = framesPerSecond(FRAME_COUNT, [&]() {
+    for (const auto & frame : frames) {
+      const MessageCodec * codec = dbc.dispatch(frame.id);
+
+      if (codec != nullptr) {
+        codec->decode(frame.data.data(), frame.length, output);
+        checksum += output.values[0];
+      }
+    }
+  });
+
+  std::cout << "Mixed IDs (" << dbc.getCodecCount() << " messages):" << std::endl;
+  std::cout << "  dispatch + decode: " << static_cast<uint64_t>(single_rate) << " frames/s" << std::endl;
+
+  const std::pair<FrameOrder, const char *> orders[] = {
+    {FrameOrder::ORIGINAL, "ORIGINAL"},
+    {FrameOrder::GROUPED, "GROUPED"}
+  };
+
+  MixedBatchOutput batch_output;
+  // Warm up so the batch output buffers are already allocated
+  dbc.decodeBatch(frames.data(), BATCH_SIZE, FrameOrder::ORIGINAL, batch_output);
+
+  for (const auto & order : orders) {
+    double batch_rate = framesPerSecond(FRAME_COUNT, [&]() {
+      for (size_t i = 0; i < FRAME_COUNT; i += BATCH_SIZE) {
+        dbc.decodeBatch(frames.data() + i, std::min(BATCH_SIZE, FRAME_COUNT - i), order.first, batch_output);
+
+        for (const auto & row : batch_output.rows) {
+          SignalHandle first_signal;
+          first_signal.message_index = batch_output.getMessageIndex(row);
+          first_signal.slot = 0;
+          checksum += batch_output.getValue(row, first_signal);
+        }
+      }
+    });
+
+    std::cout << "  decodeBatch (" << order.second << "): " << static_cast<uint64_t>(batch_rate);
+    std::cout << " frames/s" << std::endl;
+  }
+
+  std::cout << "  unknown frames counted: " << dbc.getDispatcher().getUnknownFrameCount() << std::endl;
+  std::cout << "  (checksum " << checksum << ")" << std::endl;
+}
+
+// The whole-database overlap and bounds report. Overlaps are found
+// when layouts are built, so this mostly checks bounds.
+static void runLayoutValidationBenchmark(const Database & dbc)
+{
+  const size_t rounds = 100000;
+  size_t issue_count = 0;
+
+  double rate = framesPerSecond(rounds * dbc.getCodecCount(), [&]() {
+    for (size_t i = 0; i < rounds; ++i) {
+      issue_count += dbc.validateLayouts().size();
+    }
+  });
+
+  std::cout << "Database::validateLayouts: " << static_cast<uint64_t>(rate);
+  std::cout << " messages/s, " << issue_count / rounds << " issues" << std::endl;
+}
+
+// A message protected by a counter and a CRC, configured through
+// the E2E* attributes
+static std::string buildE2EDbc()
+{
+  std::ostringstream dbc;
+
+  dbc << "VERSION \"\"\n\nBS_:\n\nBU_: ECU\n\n";
+  dbc << "BO_ 1024 PROTECTED: 8 ECU\n";
+  dbc << " SG_ CRC : 0|8@1+ (1,0) [0|255] \"\" ECU\n";
+  dbc << " SG_ COUNTER : 8|4@1+ (1,0) [0|15] \"\" ECU\n";
+  dbc << " SG_ SPEED : 16|16@1+ (0.01,0) [0|655.35] \"km/h\" ECU\n";
+  dbc << " SG_ TORQUE : 32|12@1- (0.5,-100) [-1124|923.5] \"Nm\" ECU\n";
+  dbc << " SG_ ANGLE : 55|16@0- (0.1,0) [-3276.8|3276.7] \"deg\" ECU\n\n";
+  dbc << "BA_DEF_ BO_  \"E2ECounterSignal\" STRING ;\n";
+  dbc << "BA_DEF_ BO_  \"E2EChecksumSignal\" STRING ;\n";
+  dbc << "BA_DEF_ BO_  \"E2EChecksumType\" STRING ;\n";
+  dbc << "BA_DEF_ BO_  \"E2EDataId\" INT 0 65535;\n";
+  dbc << "BA_ \"E2ECounterSignal\" BO_ 1024 \"COUNTER\";\n";
+  dbc << "BA_ \"E2EChecksumSignal\" BO_ 1024 \"CRC\";\n";
+  dbc << "BA_ \"E2EChecksumType\" BO_ 1024 \"CRC8_SAE_J1850\";\n";
+  dbc << "BA_ \"E2EDataId\" BO_ 1024 291;\n";
+
+  return dbc.str();
+}
+
+// The CRC kernels over classic and FD payloads, then a full
+// encode/decode round trip with the counter and checksum filled in
+// and verified. Returns false if the kernels disagree, the check
+// values are wrong or a frame fails verification.
+static bool runChecksumBenchmark()
+{
+  const uint8_t check_input[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  const Crc8 * sae_j1850 = Crc8::get(ChecksumType::CRC8_SAE_J1850);
+  const Crc8 * h2f = Crc8::get(ChecksumType::CRC8_H2F);
+  bool identical =
+    sae_j1850->compute(check_input, sizeof(check_input)) == 0x4B &&
+    h2f->compute(check_input, sizeof(check_input)) == 0xDF;
+
+  std::cout << "CRC8 (check values " << (identical ? "correct" : "WRONG") << "):" << std::endl;
+
+  std::mt19937 rng(0);
+
+  for (size_t length : {size_t(8), size_t(64)}) {
+    std::vector<uint8_t> frames(FRAME_COUNT * length);
+
+    for (auto & byte : frames) {
+      byte = static_cast<uint8_t>(rng());
+    }
+
+    std::vector<uint8_t> bytewise_crcs(FRAME_COUNT);
+    std::vector<uint8_t> sliced_crcs(FRAME_COUNT);
+
+    double bytewise_rate = framesPerSecond(FRAME_COUNT, [&]() {
+      for (size_t i = 0; i < FRAME_COUNT; ++i) {
+        bytewise_crcs[i] = sae_j1850->finish(
+          sae_j1850->updateBytewise(sae_j1850->getInit(), frames.data() + i * length, length));
+      }
+    });
+
+    double sliced_rate = framesPerSecond(FRAME_COUNT, [&]() {
+      for (size_t i = 0; i < FRAME_COUNT; ++i) {
+        sliced_crcs[i] = sae_j1850->compute(frames.data() + i * length, length);
+      }
+    });
+
+    identical = identical && bytewise_crcs == sliced_crcs;
+
+    std::cout << "  " << length << "-byte frames: " << static_cast<uint64_t>(bytewise_rate);
+    std::cout << " frames/s bytewise, " << static_cast<uint64_t>(sliced_rate);
+    std::cout << " frames/s slice-by-8" << std::endl;
+  }
+
+  std::istringstream dbc_stream(buildE2EDbc());
+  Database dbc(dbc_stream);
+  auto xcoders = dbc.getTranscoders();
+  MessageTranscoder & sender = xcoders.at(1024);
+  MessageTranscoder receiver = sender;
+  const size_t length = 8;
+  std::vector<uint8_t> frames(FRAME_COUNT * length);
+  SignalHandle speed;
+  speed.message_index = sender.getMessageIndex();
+  speed.slot = static_cast<uint32_t>(sender.getSlot("SPEED"));
+
+  double encode_rate = framesPerSecond(FRAME_COUNT, [&]() {
+    for (size_t i = 0; i < FRAME_COUNT; ++i) {
+      sender.getSignal(speed)->setRawValue(static_cast<int64_t>(i));
+      sender.encode(frames.data() + i * length, length);
+    }
+  });
+
+  size_t failed = 0;
+
+  double decode_rate = framesPerSecond(FRAME_COUNT, [&]() {
+    for (size_t i = 0; i < FRAME_COUNT; ++i) {
+      receiver.decode(frames.data() + i * length, length);
+      failed += (i > 0 && receiver.getE2EStatus() != E2EStatus::OK);
+    }
+  });
+
+  identical = identical && failed == 0;
+
+  std::cout << "  MessageTranscoder with counter and CRC: " << static_cast<uint64_t>(encode_rate);
+  std::cout << " frames/s encoded, " << static_cast<uint64_t>(decode_rate);
+  std::cout << " frames/s decoded and checked, " << failed << " failed" << std::endl;
+
+  return identical;
+}
+
+int main(int argc, char ** argv)
+{
+  std::istringstream dbc_stream(buildDbc());
+  Database dbc(dbc_stream);
+
+  bool identical = runKernelBenchmark();
+  identical = runChecksumBenchmark() && identical;
+
+  for (size_t i = 0; i < dbc.getCodecCount(); ++i) {
+    identical = runExtractionBenchmark(*dbc.getCodecAt(i)) && identical;
+  }
+
+  auto xcoders = dbc.getTranscoders();
+
+  for (size_t i = 0; i < dbc.getCodecCount(); ++i) {
+    const MessageCodec & codec = *dbc.getCodecAt(i);
+    runBenchmark(codec);
+    runDeltaBenchmark(xcoders.at(codec.getId()), codec.getLength());
+    runEncodeBenchmark(xcoders.at(codec.getId()), codec.getLength());
+  }
+
+  runBindingBenchmark(*dbc.getCodec(256), xcoders.at(256));
+  runMixedBenchmark(dbc);
+  runLayoutValidationBenchmark(dbc);
+
+  return identical ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+
+#include <common_defs.hpp>
+#include <database.hpp>
+
+using AS::CAN::DbcLoader::Database;
+using AS::CAN::DbcLoader::MemoryUsage;
+
+// Checks Database::memoryUsage() against the allocations actually
+// live after loading a DBC file, counted by replacing the global
+// operator new and delete. Every category has to be accounted for
+// exactly, so a member added without updating memoryUsage() shows
+// up here. Exits with 1 on a mismatch.
+//
+// Usage: memory_check [file.dbc]
+// Without a file a generated DBC with every supported section is used.
+
+// Each block starts with its size so that delete can uncount it
+union AllocationHeader
+{
+  size_t bytes;
+  std::max_align_t align;
+};
+
+static bool counting = false;
+static size_t live_bytes = 0;
+static size_t live_allocations = 0;
+
+void * operator new(size_t bytes)
+{
+  auto header = static_cast<AllocationHeader *>(std::malloc(sizeof(AllocationHeader) + bytes));
+
+  if (header == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  header->bytes = bytes;
+
+  if (counting) {
+    live_bytes += bytes;
+    live_allocations++;
+  }
+
+  return header + 1;
+}
+
+void operator delete(void * ptr) noexcept
+{
+  if (ptr == nullptr) {
+    return;
+  }
+
+  auto header = static_cast<AllocationHeader *>(ptr) - 1;
+
+  if (counting) {
+    live_bytes -= header->bytes;
+    live_allocations--;
+  }
+
+  std::free(header);
+}
+
+void operator delete(void * ptr, size_t) noexcept
+{
+  operator delete(ptr);
+}
+
+// Multiplexed and plain messages, comments long enough to leave the
+// small-string buffer, attribute definitions and values of every type,
+// value descriptions, a float signal and a counter/checksum config.
+static std::string buildDbc()
+{
+  std::ostringstream dbc;
+
+  dbc << "VERSION \"1.0\"\n\nBS_:\n\nBU_: ECU GATEWAY_WITH_A_LONG_NODE_NAME\n\n";
+
+  for (unsigned int i = 0; i < 40; ++i) {
+    dbc << "BO_ " << 256 + i << " MESSAGE_NUMBER_" << i << ": 8 ECU\n";
+    dbc << " SG_ CRC_" << i << " : 0|8@1+ (1,0) [0|255] \"\" GATEWAY_WITH_A_LONG_NODE_NAME\n";
+    dbc << " SG_ COUNTER_" << i << " : 8|4@1+ (1,0) [0|15] \"\" ECU\n";
+    dbc << " SG_ SPEED_" << i << " : 16|16@1- (0.1,-5) [-100|100] \"km/h\" ECU\n";
+    dbc << " SG_ ENGINE_SPEED_" << i << " : 39|12@0+ (0.5,0) [0|2000] \"rpm\" ECU\n\n";
+  }
+
+  dbc << "BO_ 512 MUXED: 8 ECU\n";
+  dbc << " SG_ MODE M : 0|8@1+ (1,0) [0|255] \"\" ECU\n";
+  dbc << " SG_ PAGE_0 m0 : 8|16@1+ (1,0) [0|65535] \"\" ECU\n";
+  dbc << " SG_ PAGE_1 m1 : 8|16@1- (1,0) [0|0] \"\" ECU\n";
+  dbc << " SG_ SUB m2M : 8|8@1+ (1,0) [0|255] \"\" ECU\n";
+  dbc << " SG_ SUB_PAGE_0 m0 : 16|32@1- (1,0) [0|0] \"\" ECU\n\n";
+
+  dbc << "BO_ 768 FD_FLOATS: 64 ECU\n";
+  dbc << " SG_ VALUE : 0|32@1- (1,0) [0|0] \"\" ECU\n";
+  dbc << " SG_ TAIL : 504|8@1+ (1,0) [0|255] \"\" ECU\n\n";
+
+  dbc << "CM_ BU_ ECU \"node comment long enough to heap allocate\";\n";
+  dbc << "CM_ BO_ 256 \"a message comment that is long enough\";\n";
+  dbc << "CM_ SG_ 257 SPEED_1 \"signal comment long enough to heap allocate\";\n";
+  dbc << "BA_DEF_ BU_  \"NodeLayer\" INT 0 10;\n";
+  dbc << "BA_DEF_ BO_  \"GenMsgCycleTime\" INT 0 10000;\n";
+  dbc << "BA_DEF_ BO_  \"VFrameFormat\" ENUM  \"StandardCAN\",\"ExtendedCAN\";\n";
+  dbc << "BA_DEF_ BO_  \"E2ECounterSignal\" STRING ;\n";
+  dbc << "BA_DEF_ BO_  \"E2EChecksumSignal\" STRING ;\n";
+  dbc << "BA_DEF_ BO_  \"E2EChecksumType\" STRING ;\n";
+  dbc << "BA_DEF_ SG_  \"GenSigStartValue\" FLOAT 0 100000;\n";
+  dbc << "BA_DEF_DEF_  \"GenMsgCycleTime\" 100;\n";
+  dbc << "BA_DEF_DEF_  \"VFrameFormat\" \"StandardCAN\";\n";
+  dbc << "BA_ \"NodeLayer\" BU_ ECU 2;\n";
+  dbc << "BA_ \"GenMsgCycleTime\" BO_ 256 20;\n";
+  dbc << "BA_ \"GenSigStartValue\" SG_ 256 SPEED_0 50;\n";
+
+  for (unsigned int i = 0; i < 40; i += 4) {
+    dbc << "BA_ \"E2ECounterSignal\" BO_ " << 256 + i << " \"COUNTER_" << i << "\";\n";
+    dbc << "BA_ \"E2EChecksumSignal\" BO_ " << 256 + i << " \"CRC_" << i << "\";\n";
+    dbc << "BA_ \"E2EChecksumType\" BO_ " << 256 + i << " \"CRC8_SAE_J1850\";\n";
+  }
+
+  for (unsigned int i = 0; i < 40; ++i) {
+    dbc << "VAL_ " << 256 + i << " COUNTER_" << i << " 0 \"Zero\" 1 \"One\" 15 \"Invalid\" ;\n";
+  }
+
+  dbc << "SG_MUL_VAL_ 512 SUB MODE 2-2;\n";
+  dbc << "SG_MUL_VAL_ 512 SUB_PAGE_0 SUB 0-0;\n";
+  dbc << "SIG_VALTYPE_ 768 VALUE : 1;\n";
+
+  return dbc.str();
+}
+
+static void printCategory(const char * name, const MemoryUsage::Category & category)
+{
+  std::cout << "  " << name << ": " << category.bytes << " bytes in ";
+  std::cout << category.allocations << " allocations" << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+  std::string dbc_text;
+
+  if (argc > 1) {
+    std::ifstream dbc_file(argv[1]);
+    std::ostringstream contents;
+    contents << dbc_file.rdbuf();
+    dbc_text = contents.str();
+  } else {
+    dbc_text = buildDbc();
+  }
+
+  std::istringstream dbc_stream(dbc_text);
+
+  // Only what the Database still holds once loading is done is live
+  counting = true;
+  auto dbc = new Database(dbc_stream);
+  const size_t counted_bytes = live_bytes - sizeof(Database);
+  const size_t counted_allocations = live_allocations - 1;
+  counting = false;
+
+  const MemoryUsage usage = dbc->memoryUsage();
+  const MemoryUsage::Category total = usage.total();
+
+  std::cout << "Reported by memoryUsage():" << std::endl;
+  printCategory("messages", usage.messages);
+  printCategory("signals", usage.signals);
+  printCategory("bus nodes", usage.bus_nodes);
+  printCategory("comments", usage.comments);
+  printCategory("attribute definitions", usage.attribute_definitions);
+  printCategory("attribute values", usage.attribute_values);
+  printCategory("value tables", usage.value_tables);
+  printCategory("signal layouts", usage.signal_layouts);
+  printCategory("codecs", usage.codecs);
+  printCategory("lookup tables", usage.lookup_tables);
+  printCategory("DBC text", usage.dbc_text);
+
+  const bool exact = total.bytes == counted_bytes && total.allocations == counted_allocations;
+
+  std::cout << "Total: " << total.bytes << " bytes in " << total.allocations << " allocations, ";
+  std::cout << "counted " << counted_bytes << " bytes in " << counted_allocations << " allocations, ";
+  std::cout << (exact ? "exact" : "MISMATCH") << std::endl;
+
+  delete dbc;
+
+  return exact ? 0 : 1;
+}
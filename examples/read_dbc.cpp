@@ -31,6 +31,7 @@ using AS::CAN::DbcLoader::DbcObjType;
 using AS::CAN::DbcLoader::EnumAttribute;
 using AS::CAN::DbcLoader::FloatAttribute;
 using AS::CAN::DbcLoader::IntAttribute;
+using AS::CAN::DbcLoader::LayoutIssueType;
 using AS::CAN::DbcLoader::StringAttribute;
 
 int main(int argc, char ** argv)
@@ -114,7 +115,7 @@ int main(int argc, char ** argv)
 
   std::cout << "Found " << bus_nodes.size() << " bus nodes.\n";
   std::cout << "Found " << dbc.getMessages().size() << " messages.\n";
-  std::cout << "Found " << signal_counter << " signals.\n";
+  std::cout << "Found " << signal_counter << " signals (" << dbc.getSignalLayoutCount() << " unique layouts).\n";
 
   size_t total_comments = bus_node_comment_counter + message_comment_counter + signal_comment_counter;
 
@@ -122,7 +123,27 @@ int main(int argc, char ** argv)
   std::cout << ", Messages: " << message_comment_counter << ", Signals: " << signal_comment_counter << ").\n";
   std::cout << "Found " << attr_defs.size() << " attribute definitions (Bus nodes: " << bus_node_attr_counter;
   std::cout << ", Messages: " << message_attr_counter << ", Signals: " << signal_attr_counter << ").\n";
-  std::cout << "Found " << attr_def_default_counter << " attribute default values.";
+  std::cout << "Found " << attr_def_default_counter << " attribute default values.\n";
+
+  size_t overlap_counter = 0;
+  size_t out_of_bounds_counter = 0;
+
+  for (const auto & issue : dbc.validateLayouts()) {
+    if (issue.type == LayoutIssueType::OVERLAP) {
+      overlap_counter++;
+    } else {
+      out_of_bounds_counter++;
+    }
+  }
+
+  std::cout << "Found " << overlap_counter << " overlapping signal pairs and ";
+  std::cout << out_of_bounds_counter << " signals past their message length.\n";
+
+  auto mem_usage = dbc.memoryUsage();
+
+  std::cout << "Using " << mem_usage.total().bytes << " bytes in " << mem_usage.total().allocations;
+  std::cout << " allocations (Messages: " << mem_usage.messages.bytes << ", Signals: " << mem_usage.signals.bytes;
+  std::cout << ", Comments: " << mem_usage.comments.bytes << ", DBC text: " << mem_usage.dbc_text.bytes << ").";
   std::cout << std::endl;
   
   return 0;
@@ -44,6 +44,8 @@ public:
   virtual DbcObjType getDbcObjType() const;
   virtual AttributeType getAttrType() const = 0;
 
+  friend class Database;
+
 protected:
   void generateText() override;
   void parse() override;
@@ -81,6 +83,8 @@ public:
   const std::string * getDefaultValue() const;
   AttributeType getAttrType() const { return AttributeType::ENUM; };
 
+  friend class Database;
+
 private:
   void generateDefaultValueText();
   std::string generateTypeSpecificText();
@@ -114,6 +118,8 @@ public:
   const float * getDefaultValue() const;
   AttributeType getAttrType() const { return AttributeType::FLOAT; };
 
+  friend class Database;
+
 private:
   void generateDefaultValueText();
   std::string generateTypeSpecificText();
@@ -147,6 +153,8 @@ public:
   const int * getDefaultValue() const;
   AttributeType getAttrType() const { return AttributeType::INT; };
 
+  friend class Database;
+
 private:
   void generateDefaultValueText();
   std::string generateTypeSpecificText();
@@ -177,6 +185,8 @@ public:
   AttributeType getAttrType() const { return AttributeType::STRING; };
   const std::string * getDefaultValue() const;
 
+  friend class Database;
+
 private:
   void generateDefaultValueText();
   std::string generateTypeSpecificText();
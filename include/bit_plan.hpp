@@ -0,0 +1,213 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef BIT_PLAN_HPP_
+#define BIT_PLAN_HPP_
+
+#include "common_defs.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+static constexpr size_t MAX_FRAME_LENGTH = 64;
+
+// Frames are copied into a zero-filled buffer with this much room on
+// either side so that every signal can be read with one unaligned
+// 8-byte load plus one spill byte, without bounds checks.
+static constexpr size_t FRAME_PADDING = 8;
+
+using PaddedFrame = std::array<uint8_t, FRAME_PADDING + MAX_FRAME_LENGTH + FRAME_PADDING>;
+
+inline uint64_t byteSwap64(uint64_t value)
+{
+  return ((value & 0x00000000000000FFULL) << 56) |
+         ((value & 0x000000000000FF00ULL) << 40) |
+         ((value & 0x0000000000FF0000ULL) << 24) |
+         ((value & 0x00000000FF000000ULL) << 8) |
+         ((value & 0x000000FF00000000ULL) >> 8) |
+         ((value & 0x0000FF0000000000ULL) >> 24) |
+         ((value & 0x00FF000000000000ULL) >> 40) |
+         ((value & 0xFF00000000000000ULL) >> 56);
+}
+
+inline uint64_t loadLe64(const uint8_t * bytes)
+{
+  uint64_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  value = byteSwap64(value);
+#endif
+  return value;
+}
+
+inline uint64_t loadBe64(const uint8_t * bytes)
+{
+  uint64_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  value = byteSwap64(value);
+#endif
+  return value;
+}
+
+inline void storeLe64(uint8_t * bytes, uint64_t value)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  value = byteSwap64(value);
+#endif
+  std::memcpy(bytes, &value, sizeof(value));
+}
+
+inline void storeBe64(uint8_t * bytes, uint64_t value)
+{
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  value = byteSwap64(value);
+#endif
+  std::memcpy(bytes, &value, sizeof(value));
+}
+
+// Precompiled location of a signal within a frame.
+// Motorola (BE) sawtooth bit numbering is resolved when the plan is
+// built so extraction is the same handful of shifts and masks for
+// either byte order.
+struct BitPlan
+{
+  BitPlan() = default;
+  BitPlan(unsigned short start_bit, unsigned char length, Order endianness, bool is_signed);
+
+  // Byte offset of the 8-byte load window, relative to the frame start
+  int16_t window;
+  // Right shift which moves the signal's LSB to bit 0 of the window
+  uint8_t shift;
+  bool big_endian;
+  // Number of payload bytes needed to hold the whole signal
+  uint8_t end_byte;
+  uint64_t mask;
+  // Zero for unsigned signals
+  uint64_t sign_bit;
+  // Signal bits within the load window (mask << shift) for PEXT/PDEP.
+  // Zero when the signal spills past the window.
+  uint64_t pext_mask;
+
+  // Returns the raw value, sign-extended to 64 bits for signed signals.
+  // padded_frame must point at the start of the PaddedFrame buffer.
+  inline uint64_t extract(const uint8_t * padded_frame) const
+  {
+    const uint8_t * window_ptr = padded_frame + FRAME_PADDING + window;
+    uint64_t word;
+    uint64_t spill;
+
+    if (big_endian) {
+      word = loadBe64(window_ptr);
+      spill = window_ptr[-1];
+    } else {
+      word = loadLe64(window_ptr);
+      spill = window_ptr[8];
+    }
+
+    // Bits beyond the 8-byte window come from the spill byte. Splitting
+    // the shift keeps it defined when shift is zero and there is no spill.
+    uint64_t raw = ((word >> shift) | (spill << 1 << (63 - shift))) & mask;
+
+    return (raw ^ sign_bit) - sign_bit;
+  }
+
+  // Writes the low bits of raw into the frame, leaving all other
+  // bits untouched. padded_frame must point at the start of the
+  // PaddedFrame buffer.
+  inline void insert(uint8_t * padded_frame, uint64_t raw) const
+  {
+    uint8_t * window_ptr = padded_frame + FRAME_PADDING + window;
+    uint8_t * spill_ptr;
+    uint64_t word;
+
+    raw &= mask;
+
+    if (big_endian) {
+      spill_ptr = window_ptr - 1;
+      word = loadBe64(window_ptr);
+    } else {
+      spill_ptr = window_ptr + 8;
+      word = loadLe64(window_ptr);
+    }
+
+    word = (word & ~(mask << shift)) | (raw << shift);
+
+    uint64_t spill_mask = mask >> 1 >> (63 - shift);
+    *spill_ptr = static_cast<uint8_t>(
+      (*spill_ptr & ~spill_mask) | (raw >> 1 >> (63 - shift)));
+
+    if (big_endian) {
+      storeBe64(window_ptr, word);
+    } else {
+      storeLe64(window_ptr, word);
+    }
+  }
+};
+
+enum class BitPlanBackend
+{
+  SHIFT_MASK,
+  BMI2
+};
+
+// Frame and column loops over BitPlans. The BMI2 backend gathers and
+// scatters signal bits with PEXT/PDEP and falls back to shift-and-mask
+// for signals which spill past their load window. Both backends
+// produce identical results.
+struct BitPlanKernels
+{
+  BitPlanBackend backend;
+
+  // raw[i] = plans[i].extract(padded_frame)
+  void (* extractFrame)(
+    const BitPlan * plans, size_t count, const uint8_t * padded_frame, int64_t * raw);
+  // plans[i].insert(padded_frame, raw[i])
+  void (* insertFrame)(
+    const BitPlan * plans, size_t count, const int64_t * raw, uint8_t * padded_frame);
+  // column[i] = plan.extract(frames + i * pitch) for padded frames
+  // stored pitch bytes apart
+  void (* extractColumn)(
+    const BitPlan & plan, const uint8_t * frames, size_t pitch, size_t frame_count,
+    int64_t * column);
+};
+
+// Maximum frame_count for BitPlanKernels::extractColumn()
+static constexpr size_t MAX_COLUMN_CHUNK = 256;
+
+// BMI2 when the CPU has a fast implementation, otherwise shift-and-mask
+const BitPlanKernels & getBitPlanKernels();
+// Returns nullptr if the CPU doesn't support the requested backend
+const BitPlanKernels * getBitPlanKernels(BitPlanBackend backend);
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
+
+#endif  // BIT_PLAN_HPP_
@@ -49,6 +49,7 @@ public:
   const std::string * getComment() const;
 
   friend class Database;
+  friend class DatabaseDiff;
   friend class Message;
   friend class Signal;
 
@@ -22,7 +22,11 @@
 #define COMMON_DEFS_HPP_
 
 #include <array>
+#include <cstdint>
+#include <cstring>
 #include <exception>
+#include <functional>
+#include <string>
 #include <unordered_map>
 
 namespace AS
@@ -61,10 +65,9 @@ static constexpr std::array<unsigned char, 16> DLC_LENGTH =
 //   SIGTYPE_VALTYPE_
 //   SIG_GROUP_
 //   SIG_TYPE_REF_
-//   SIG_VALTYPE_
 //   VAL_TABLE_
 
-static const std::array<std::string, 10> PREAMBLES =
+static const std::array<std::string, 12> PREAMBLES =
 {
   "VERSION",      // VERSION
   "BS_:",         // BUS CONFIG
@@ -75,9 +78,25 @@ static const std::array<std::string, 10> PREAMBLES =
   "VAL_",         // SIGNAL VALUE LIST
   "BA_DEF_",      // ATTRIBUTE DEFINITION
   "BA_DEF_DEF_",  // ATTRIBUTE DEFAULT VALUE
-  "BA_"           // ATTRIBUTE VALUE
+  "BA_",          // ATTRIBUTE VALUE
+  "SG_MUL_VAL_",  // EXTENDED MULTIPLEXING
+  "SIG_VALTYPE_"  // SIGNAL VALUE TYPE
 };
 
+// Signal attribute holding the raw value a signal has until it is
+// first set, used for MessageTranscoder's template frames
+static const std::string START_VALUE_ATTR = "GenSigStartValue";
+
+// Message attributes configuring counter and checksum signals, see
+// E2EConfig. E2EChecksumType is "CRC8_SAE_J1850", "CRC8_H2F" or
+// "NONE", or an ENUM attribute with those values.
+static const std::string E2E_COUNTER_SIGNAL_ATTR = "E2ECounterSignal";
+static const std::string E2E_COUNTER_MAX_ATTR = "E2ECounterMax";
+static const std::string E2E_MAX_DELTA_COUNTER_ATTR = "E2EMaxDeltaCounter";
+static const std::string E2E_CHECKSUM_SIGNAL_ATTR = "E2EChecksumSignal";
+static const std::string E2E_CHECKSUM_TYPE_ATTR = "E2EChecksumType";
+static const std::string E2E_DATA_ID_ATTR = "E2EDataId";
+
 enum class AttributeType
 {
   ENUM,
@@ -106,11 +125,112 @@ enum class Order
   LE
 };
 
+// How a signal's raw bits are interpreted (SIG_VALTYPE_).
+// FLOAT signals are 32 bits long and DOUBLE signals 64 bits long.
+enum class SignalValueType
+{
+  INTEGER,
+  FLOAT,
+  DOUBLE
+};
+
 enum class TranscodeErrorType
 {
-  NONE
+  NONE,
+  INVALID_LENGTH,
+  OUT_OF_RANGE
+};
+
+// What encoding does with a signal whose physical value is outside
+// its [min|max] range. Signals whose min isn't below their max, such
+// as the common [0|0], have no range and are never out of it.
+enum class RangePolicy
+{
+  // Encode the value as it is
+  IGNORE,
+  // Encode the nearest value inside the range
+  CLAMP,
+  // Fail with TranscodeErrorType::OUT_OF_RANGE and leave the frame alone
+  REJECT,
+  // Encode the value as it is and report it in the violation mask
+  FLAG
 };
 
+// Range violations are reported as one bit per layout slot,
+// bit (slot % 64) of word (slot / 64)
+inline size_t violationMaskWords(size_t slot_count)
+{
+  return (slot_count + 63) / 64;
+}
+
+inline void hashCombine(size_t & seed, size_t value)
+{
+  seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+inline size_t floatBits(float value)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// Reinterprets the raw bits of a FLOAT or DOUBLE signal.
+// Sign-extended raw values are fine since only the low 32 bits
+// of a FLOAT are used.
+inline double ieeeValue(SignalValueType type, uint64_t raw)
+{
+  if (type == SignalValueType::FLOAT) {
+    const uint32_t bits = static_cast<uint32_t>(raw);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  double value;
+  std::memcpy(&value, &raw, sizeof(value));
+  return value;
+}
+
+// Physical value of a FLOAT or DOUBLE signal. Identity scaling, by
+// far the most common, is skipped so that -0.0 and infinities come
+// through exactly as they were sent.
+inline double ieeePhysical(SignalValueType type, uint64_t raw, double factor, double offset)
+{
+  const double value = ieeeValue(type, raw);
+  return (factor == 1.0 && offset == 0.0) ? value : value * factor + offset;
+}
+
+// The raw bits of a FLOAT or DOUBLE signal holding value
+inline uint64_t ieeeBits(SignalValueType type, double value)
+{
+  if (type == SignalValueType::FLOAT) {
+    const float narrow = static_cast<float>(value);
+    uint32_t bits;
+    std::memcpy(&bits, &narrow, sizeof(bits));
+    return bits;
+  }
+
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// Order-independent hash of a set of attribute values
+inline size_t hashAttrValues(const std::unordered_map<std::string, std::string> & values)
+{
+  std::hash<std::string> str_hash;
+  size_t sum = 0;
+
+  for (const auto & value : values) {
+    size_t seed = str_hash(value.first);
+    hashCombine(seed, str_hash(value.second));
+    sum += seed;
+  }
+
+  return sum;
+}
+
 struct DbcReadException
   : public std::exception
 {
@@ -138,11 +258,56 @@ struct DbcParseException
   }
 };
 
+struct DbcEditException
+  : public std::exception
+{
+  const char * what() const throw()
+  {
+    return "Exception when editing DBC object.";
+  }
+};
+
+struct DbcCommitConflictException
+  : public std::exception
+{
+  const char * what() const throw()
+  {
+    return "Exception when committing conflicting DBC changes.";
+  }
+};
+
+struct DbcSubscriptionException
+  : public std::exception
+{
+  const char * what() const throw()
+  {
+    return "Exception when subscribing to DBC signals.";
+  }
+};
+
+struct DbcBindingException
+  : public std::exception
+{
+  const char * what() const throw()
+  {
+    return "Exception when binding DBC signals to a struct.";
+  }
+};
+
+struct DbcE2EConfigException
+  : public std::exception
+{
+  const char * what() const throw()
+  {
+    return "Exception when configuring DBC counter and checksum signals.";
+  }
+};
+
 class DbcObj
 {
 public:
   virtual ~DbcObj() {};
-  const std::string getDbcText()
+  const std::string getDbcText() const
   {
     return dbc_text_;
   }
@@ -160,16 +325,19 @@ private:
 class AttrObj
 {
 public:
-  const std::unordered_map<std::string, std::string> getAttributeValues()
+  const std::unordered_map<std::string, std::string> getAttributeValues() const
   {
     return attribute_values_;
   }
 
-  const bool hasAttributeValues()
+  const bool hasAttributeValues() const
   {
-    return (attribute_values_.size() < 1);
+    return !attribute_values_.empty();
   }
 
+  friend class DatabaseDiff;
+  friend class DatabaseTransaction;
+
 protected:
   std::unordered_map<std::string, std::string> attribute_values_;
 };
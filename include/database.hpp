@@ -25,8 +25,15 @@
 #include "attribute.hpp"
 #include "bus_node.hpp"
 #include "comment.hpp"
+#include "enum_resolver.hpp"
+#include "frame_dispatcher.hpp"
+#include "lookup_table.hpp"
 #include "message.hpp"
+#include "message_codec.hpp"
+#include "signal_layout.hpp"
 
+#include <array>
+#include <cstdint>
 #include <fstream>
 #include <istream>
 #include <map>
@@ -42,9 +49,132 @@ namespace CAN
 namespace DbcLoader
 {
 
+// Approximate heap usage of a loaded Database, broken down by what owns it.
+// Byte counts are the sizes requested from the allocator (container nodes,
+// bucket arrays, out-of-line string buffers, etc.) and do not include the
+// Database object itself.
+struct MemoryUsage
+{
+  struct Category
+  {
+    size_t bytes = 0;
+    size_t allocations = 0;
+  };
+
+  Category messages;
+  Category signals;
+  Category bus_nodes;
+  Category comments;
+  Category attribute_definitions;
+  Category attribute_values;
+  Category value_tables;
+  Category signal_layouts;
+  Category codecs;
+  Category lookup_tables;
+  Category dbc_text;
+
+  Category total() const;
+};
+
+// One received frame as it comes off a socket or out of a log file.
+// timestamp is carried through untouched, so any unit will do.
+struct CanFrame
+{
+  unsigned int id = 0;
+  uint8_t length = 0;
+  uint64_t timestamp = 0;
+  std::array<uint8_t, MAX_FRAME_LENGTH> data{};
+};
+
+// Order of MixedBatchOutput::rows
+enum class FrameOrder
+{
+  ORIGINAL,  // as the frames were passed in
+  GROUPED    // by message ID, then as passed in
+};
+
+// Results of Database::decodeBatch() on frames of mixed messages.
+// Frames of each message are decoded together into one group; rows
+// say which group and which frame within it each input frame became.
+// Reusing a MixedBatchOutput between calls avoids allocation once it
+// has grown to the largest batch.
+struct MixedBatchOutput
+{
+  struct Group
+  {
+    uint32_t message_index = 0;
+    // Range of frame_order holding this group's frames
+    size_t first = 0;
+    size_t frame_count = 0;
+    MessageCodec::BatchOutput batch;
+  };
+
+  struct Row
+  {
+    size_t frame_index;
+    uint32_t group;
+    uint32_t row;
+    uint64_t timestamp;
+  };
+
+  // Only the first group_count groups belong to the last batch.
+  // Groups are in message ID order.
+  std::vector<Group> groups;
+  size_t group_count = 0;
+  std::vector<Row> rows;
+  // Input indices of the decoded frames, grouped
+  std::vector<size_t> frame_order;
+  // Frames with an unknown ID or a payload shorter than the message
+  size_t skipped = 0;
+  // Scratch space for the grouping pass
+  std::vector<int32_t> frame_groups;
+  std::vector<int32_t> message_groups;
+  std::vector<const uint8_t *> payloads;
+
+  // The handle must belong to the row's message, see getMessageIndex()
+  double getValue(const Row & row, const SignalHandle & handle) const
+  {
+    return groups[row.group].batch.getColumn(handle)[row.row];
+  }
+
+  int64_t getRawValue(const Row & row, const SignalHandle & handle) const
+  {
+    return groups[row.group].batch.getRawColumn(handle)[row.row];
+  }
+
+  bool isActive(const Row & row, const SignalHandle & handle) const
+  {
+    const uint8_t * active = groups[row.group].batch.getActiveColumn(handle);
+    return active == nullptr || active[row.row] != 0;
+  }
+
+  uint32_t getMessageIndex(const Row & row) const
+  {
+    return groups[row.group].message_index;
+  }
+};
+
+enum class LayoutIssueType
+{
+  OVERLAP,       // Shares bits with other_signal in some frame
+  OUT_OF_BOUNDS  // Has bits past the message length or fits no frame
+};
+
+struct LayoutIssue
+{
+  LayoutIssueType type;
+  unsigned int msg_id;
+  SignalHandle signal;
+  // Lower slot than signal. Invalid for OUT_OF_BOUNDS.
+  SignalHandle other_signal;
+};
+
 class Database
 {
 public:
+  // Throw DbcParseException on malformed DBC text and
+  // DbcE2EConfigException if a message's E2E* attributes name signals
+  // which can't serve as its counter or checksum, see E2EConfig
   Database(const std::string & dbc_path);
   Database(std::istream & mem_stream);
   Database(
@@ -59,9 +189,50 @@ public:
   std::vector<const BusNode *> getBusNodes() const;
   std::unordered_map<unsigned int, const Message *> getMessages() const;
   std::vector<const Attribute *> getAttributeDefinitions() const;
+  size_t getSignalLayoutCount() const;
   void writeDbcToFile(const std::string & dbc_path) const;
   void writeDbcToStream(std::ostream & mem_stream) const;
+  // Transcoders share the Database's lookup tables
   std::unordered_map<unsigned int, MessageTranscoder> getTranscoders();
+  // Rebuilds the lookup tables used by transcoders created afterwards.
+  // Tables are built with the default LookupTableConfig at load time.
+  void setLookupTableConfig(const LookupTableConfig & config);
+  size_t getLookupTableCount() const;
+  // Shared, thread-safe codecs built once at load time.
+  // Returns nullptr for unknown message IDs.
+  const MessageCodec * getCodec(unsigned int msg_id) const;
+  // As getCodec(msg_id) for received frames: unknown IDs are counted
+  // by the dispatcher, see getDispatcher().
+  const MessageCodec * dispatch(unsigned int msg_id) const;
+  const FrameDispatcher & getDispatcher() const;
+  const MessageCodec * getCodec(const SignalHandle & handle) const;
+  // Codecs are indexed in message ID order
+  size_t getCodecCount() const;
+  const MessageCodec * getCodecAt(size_t message_index) const;
+  // Returns an invalid handle if the message or signal doesn't exist
+  SignalHandle getSignalHandle(unsigned int msg_id, const std::string & signal_name) const;
+  // Value description lookup for a signal, built once at load time.
+  // Signals with identical descriptions share a resolver and every
+  // label is stored once. Returns nullptr if the signal has none.
+  const EnumResolver * getEnumResolver(const SignalHandle & handle) const;
+  // Decodes a batch of frames with any mix of IDs. Frames are bucketed
+  // by message with a stable counting pass and every bucket goes
+  // through MessageCodec::decodeBatch(). Frames with an unknown ID or
+  // a short payload are skipped and counted in output.skipped, and
+  // unknown IDs are also counted by the dispatcher.
+  void decodeBatch(
+    const CanFrame * frames,
+    size_t frame_count,
+    FrameOrder order,
+    MixedBatchOutput & output) const;
+  // Every out-of-bounds signal and overlapping pair of signals, by
+  // message in ID order and then by slot. Signals on different pages of a
+  // multiplexer don't overlap. Overlaps come precomputed with the
+  // shared layouts, so this is a pass over the codecs.
+  std::vector<LayoutIssue> validateLayouts() const;
+  MemoryUsage memoryUsage() const;
+
+  friend class VersionedDatabase;
 
 private:
   std::string version_;
@@ -69,7 +240,18 @@ private:
   std::vector<BusNode> bus_nodes_;
   std::unordered_map<unsigned int, Message> messages_;
   std::vector<std::unique_ptr<Attribute>> attribute_defs_;
+  SignalLayoutPool layout_pool_;
+  std::vector<MessageCodec> codecs_;
+  FrameDispatcher dispatcher_;
+  LookupTablePool lookup_tables_;
+  LabelPool label_pool_;
+  std::vector<EnumResolver> enum_resolvers_;
+  // Index into enum_resolvers_ (or -1) by codec index and slot
+  std::vector<std::vector<int32_t>> enum_resolver_indices_;
 
+  void buildCodecs();
+  void buildEnumResolvers();
+  void buildLookupTables(const LookupTableConfig & config);
   void generate(std::ostream & writer) const;
   void parse(std::istream & reader);
   void saveMsg(std::unique_ptr<Message> & msg_ptr);
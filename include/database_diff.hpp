@@ -0,0 +1,128 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef DATABASE_DIFF_HPP_
+#define DATABASE_DIFF_HPP_
+
+#include "common_defs.hpp"
+#include "attribute.hpp"
+#include "bus_node.hpp"
+#include "database.hpp"
+#include "message.hpp"
+#include "signal.hpp"
+#include "versioned_database.hpp"
+
+#include <string>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+enum class ChangeType
+{
+  ADDED,
+  REMOVED,
+  MODIFIED
+};
+
+// Bus nodes only have a name, so they are never MODIFIED
+struct BusNodeChange
+{
+  std::string node_name;
+  ChangeType type;
+};
+
+struct MessageChange
+{
+  unsigned int msg_id;
+  ChangeType type;
+};
+
+struct SignalChange
+{
+  unsigned int msg_id;
+  std::string signal_name;
+  ChangeType type;
+};
+
+// obj_type is BUS_NODES, MESSAGE or SIGNAL.
+// node_or_signal_name is empty for message comments.
+struct CommentChange
+{
+  DbcObjType obj_type;
+  unsigned int msg_id;
+  std::string node_or_signal_name;
+  ChangeType type;
+};
+
+// obj_type is ATTRIBUTE_DEF for changes to the definitions themselves,
+// otherwise the type of the object the attribute value is attached to.
+struct AttributeChange
+{
+  DbcObjType obj_type;
+  unsigned int msg_id;
+  std::string node_or_signal_name;
+  std::string attr_name;
+  ChangeType type;
+};
+
+// Semantic differences between two databases, reported in ID/name order.
+// Bus node, message and signal changes only cover their definitions;
+// comment and attribute value changes are reported separately. The
+// signals, comments and attribute values of added and removed messages
+// and nodes are reported as ADDED or REMOVED too.
+class DatabaseDiff
+{
+public:
+  DatabaseDiff(const Database & from, const Database & to);
+  DatabaseDiff(const DatabaseSnapshot & from, const DatabaseSnapshot & to);
+
+  const std::vector<BusNodeChange> & getBusNodeChanges() const;
+  const std::vector<MessageChange> & getMessageChanges() const;
+  const std::vector<SignalChange> & getSignalChanges() const;
+  const std::vector<CommentChange> & getCommentChanges() const;
+  const std::vector<AttributeChange> & getAttributeChanges() const;
+  bool empty() const;
+
+private:
+  template<typename DB>
+  void compare(const DB & from, const DB & to);
+  // Records signal, comment and attribute value changes. Returns
+  // true if the message definition itself changed.
+  bool compareMessages(const Message & from, const Message & to);
+  void sortChanges();
+
+  std::vector<BusNodeChange> bus_node_changes_;
+  std::vector<MessageChange> message_changes_;
+  std::vector<SignalChange> signal_changes_;
+  std::vector<CommentChange> comment_changes_;
+  std::vector<AttributeChange> attribute_changes_;
+};
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
+
+#endif  // DATABASE_DIFF_HPP_
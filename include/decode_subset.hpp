@@ -0,0 +1,170 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#ifndef DECODE_SUBSET_HPP_
+#define DECODE_SUBSET_HPP_
+
+#include "common_defs.hpp"
+#include "bit_plan.hpp"
+#include "message_codec.hpp"
+#include "signal_layout.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+// What DecodeSubset::decode() produces for a signal. Every mode fills
+// MessageCodec::Output::raw_values (sign-extended for signed signals,
+// zero-extended otherwise) and active.
+enum class DecodeMode
+{
+  // Also Output::values, as MessageCodec::decode() would
+  PHYSICAL,
+  // Nothing else, so no floating point is involved at all
+  RAW,
+  // Also Output::fixed_values: the physical value as an integer count
+  // of 10^exponent, computed with integer arithmetic only. See
+  // DecodeSubset::getFixedPointExponent(). FLOAT and DOUBLE signals
+  // are the exception: their physical value is rounded, saturating.
+  FIXED_POINT
+};
+
+// A subset of a MessageCodec's signals compiled for decoding on its
+// own. Multiplexer switches which a requested signal depends on are
+// pulled in automatically and only produce raw values. Decoding
+// writes the same slots of a MessageCodec::Output that
+// MessageCodec::decode() would, so handles work unchanged, and leaves
+// every other slot alone.
+class DecodeSubset
+{
+public:
+  // Throws DbcSubscriptionException for handles outside the codec or
+  // of another message (see MessageCodec::getMessageIndex()), and
+  // for FIXED_POINT integer signals whose factor or offset at their
+  // fixed-point exponent doesn't fit in an int64_t, or whose non-zero
+  // factor rounds to zero there (below 5e-10).
+  DecodeSubset(
+    const MessageCodec & codec,
+    const std::vector<SignalHandle> & signals,
+    DecodeMode mode = DecodeMode::PHYSICAL);
+  // Each signal decoded in its own mode. A signal listed more than
+  // once gets the outputs of every mode it is listed with. Throws as
+  // above.
+  DecodeSubset(
+    const MessageCodec & codec,
+    const std::vector<std::pair<SignalHandle, DecodeMode>> & signals);
+
+  const MessageCodec * getCodec() const;
+  // Layout slots decoded by this subset, in decode order
+  const std::vector<uint32_t> & getSlots() const;
+  bool contains(const SignalHandle & handle) const;
+  // Decimal exponent of the signal's Output::fixed_values. It is the
+  // largest one, down to -9, at which the signal's factor and offset
+  // are whole numbers to float precision. Factors which don't have one
+  // (1/3, say) are rounded at -9. FLOAT and DOUBLE signals always
+  // use -6.
+  int getFixedPointExponent(const SignalHandle & handle) const;
+
+  TranscodeErrorType decode(
+    const uint8_t * frame,
+    size_t frame_length,
+    MessageCodec::Output & output) const;
+
+private:
+  struct Entry
+  {
+    BitPlan plan;
+    uint32_t slot;
+    // Index of the entry holding this slot's switch, -1 if unconditional
+    int32_t switch_entry;
+    bool physical;
+    bool fixed_point;
+    SignalValueType value_type;
+    double factor;
+    double offset;
+    int64_t fixed_factor;
+    int64_t fixed_offset;
+    // 10^-exponent, only used for FLOAT and DOUBLE signals
+    double fixed_scale;
+  };
+
+  const MessageCodec * codec_;
+  std::vector<Entry> entries_;
+  std::vector<uint32_t> slots_;
+  // Switch values selecting each conditional entry, by entry index
+  std::vector<std::vector<std::pair<unsigned int, unsigned int>>> ranges_;
+  std::vector<bool> contained_;
+  std::vector<int> fixed_exponents_;
+
+  void compile(
+    const MessageCodec & codec,
+    const std::vector<std::pair<SignalHandle, DecodeMode>> & signals);
+};
+
+// Subscribers to signals of one message which share a single decode.
+// The group keeps the union of every subscription compiled as one
+// DecodeSubset, so a signal wanted by several subscribers is decoded
+// once per frame and each subscriber reads its own handles from the
+// shared Output.
+class SubscriptionGroup
+{
+public:
+  SubscriptionGroup(const MessageCodec & codec);
+
+  // Returns an id for unsubscribe(). Throws DbcSubscriptionException
+  // as DecodeSubset does, leaving the group unchanged.
+  size_t subscribe(
+    const std::vector<SignalHandle> & signals,
+    DecodeMode mode = DecodeMode::PHYSICAL);
+  void unsubscribe(size_t subscription_id);
+  size_t getSubscriptionCount() const;
+  const DecodeSubset & getSubset() const;
+
+  TranscodeErrorType decode(
+    const uint8_t * frame,
+    size_t frame_length,
+    MessageCodec::Output & output) const;
+
+private:
+  const MessageCodec * codec_;
+  size_t next_id_;
+  std::map<size_t, std::vector<std::pair<SignalHandle, DecodeMode>>> subscriptions_;
+  DecodeSubset subset_;
+
+  // Signals of every subscription but skipped_id
+  std::vector<std::pair<SignalHandle, DecodeMode>> collectSignals(size_t skipped_id) const;
+};
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
+
+#endif  // DECODE_SUBSET_HPP_
@@ -0,0 +1,145 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef E2E_HPP_
+#define E2E_HPP_
+
+#include "common_defs.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+class Message;
+
+enum class ChecksumType
+{
+  NONE,
+  CRC8_SAE_J1850,  // Polynomial 0x1D, init and final XOR 0xFF
+  CRC8_H2F         // Polynomial 0x2F, init and final XOR 0xFF
+};
+
+enum class E2EStatus
+{
+  OK,
+  INITIAL,         // First frame, so there is no counter to compare with
+  REPEATED,        // Same counter as the previous frame
+  WRONG_SEQUENCE,  // Counter jumped by more than max_counter_delta or is out of range
+  BAD_CHECKSUM
+};
+
+// Table-driven CRC-8 with a non-reflected polynomial.
+class Crc8
+{
+public:
+  Crc8(uint8_t polynomial, uint8_t init, uint8_t xor_out);
+
+  // Shared instance for a checksum type, nullptr for NONE
+  static const Crc8 * get(ChecksumType type);
+
+  uint8_t getInit() const;
+  // Slice-by-8: eight bytes per step with independent table lookups,
+  // bytewise for the rest. Doesn't apply init or the final XOR.
+  uint8_t update(uint8_t crc, const uint8_t * data, size_t length) const;
+  // One dependent table lookup per byte. Same result as update().
+  uint8_t updateBytewise(uint8_t crc, const uint8_t * data, size_t length) const;
+  uint8_t finish(uint8_t crc) const;
+  uint8_t compute(const uint8_t * data, size_t length) const;
+
+private:
+  // tables_[k][x] is the CRC register after x followed by k zero bytes
+  std::array<std::array<uint8_t, 256>, 8> tables_;
+  uint8_t init_;
+  uint8_t xor_out_;
+};
+
+// Alive counter and checksum signals of a message, in the style of
+// the AUTOSAR E2E profiles. Either part can be left out.
+// The checksum is the CRC of the data ID (low byte first) followed by
+// the payload without the checksum byte.
+struct E2EConfig
+{
+  std::string counter_signal;
+  // Counters wrap to 0 after this. 0 uses the signal's full range.
+  uint64_t counter_max = 0;
+  // Largest counter step still accepted as OK. Larger steps mean
+  // frames were lost.
+  uint64_t max_counter_delta = 1;
+  // Must be an unsigned, byte-aligned 8-bit signal
+  std::string checksum_signal;
+  ChecksumType checksum_type = ChecksumType::NONE;
+  uint16_t data_id = 0;
+
+  bool isEnabled() const
+  {
+    return !counter_signal.empty() || checksum_type != ChecksumType::NONE;
+  }
+};
+
+// A message's E2EConfig resolved against its layout.
+class E2EProfile
+{
+public:
+  // Disabled profile
+  E2EProfile();
+  // Throws DbcE2EConfigException if a configured signal doesn't exist,
+  // is multiplexed or isn't suitable for its role
+  E2EProfile(const Message & msg);
+
+  bool isEnabled() const;
+  // -1 without a counter
+  int getCounterSlot() const;
+  // -1 without a checksum
+  int getChecksumSlot() const;
+  uint64_t getCounterMax() const;
+  uint64_t nextCounter(uint64_t counter) const;
+  // WRONG_SEQUENCE if either counter is above getCounterMax()
+  E2EStatus checkCounter(uint64_t previous, uint64_t received) const;
+  // Over length payload bytes. The checksum byte itself is skipped.
+  uint8_t computeChecksum(const uint8_t * frame) const;
+  void writeChecksum(uint8_t * frame) const;
+  bool verifyChecksum(const uint8_t * frame) const;
+
+private:
+  const Crc8 * crc_;
+  int counter_slot_;
+  int checksum_slot_;
+  uint64_t counter_max_;
+  uint64_t max_counter_delta_;
+  size_t checksum_byte_;
+  size_t length_;
+  // CRC register after the data ID bytes
+  uint8_t data_id_crc_;
+};
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
+
+#endif  // E2E_HPP_
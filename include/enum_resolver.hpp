@@ -0,0 +1,114 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#ifndef ENUM_RESOLVER_HPP_
+#define ENUM_RESOLVER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+// Non-owning view of a label in a LabelPool. data is nullptr for
+// values without a label.
+struct StringView
+{
+  const char * data = nullptr;
+  size_t size = 0;
+
+  bool empty() const
+  {
+    return size == 0;
+  }
+
+  std::string toString() const
+  {
+    return std::string(data == nullptr ? "" : data, size);
+  }
+};
+
+// Value description strings stored once, back to back. Views into
+// the pool stay valid for as long as the pool, including after it
+// has been moved.
+class LabelPool
+{
+public:
+  // Offset of the label, adding it if it isn't in the pool yet.
+  // Views can only be taken once every label has been added.
+  size_t add(const std::string & label);
+  StringView view(size_t offset, size_t size) const;
+
+  friend class Database;
+
+private:
+  std::vector<char> chars_;
+  std::map<std::string, size_t> offsets_;
+};
+
+// Resolves raw values of one signal to their value descriptions.
+// Keys spanning a small range are looked up in a dense array indexed
+// by the raw value, anything else by binary search over sorted keys.
+class EnumResolver
+{
+public:
+  // Value descriptions as parsed from VAL_ lines. Keys are reduced to
+  // the signal's width and sign-extended for signed signals so that
+  // they compare equal to decoded raw values.
+  EnumResolver(
+    const std::map<unsigned int, std::string> & value_descs,
+    unsigned int length,
+    bool is_signed,
+    LabelPool & pool);
+
+  // Resolves the views once the pool is complete
+  void finalize(const LabelPool & pool);
+
+  // Empty view if the value has no description
+  StringView resolve(int64_t raw_value) const;
+  // labels[i] = resolve(raw_values[i]), e.g. over a decoded column
+  void resolve(const int64_t * raw_values, size_t count, StringView * labels) const;
+  bool isDense() const;
+
+  friend class Database;
+
+private:
+  // Pool offset and size of each label, until finalize()
+  std::vector<std::pair<size_t, size_t>> label_refs_;
+  std::vector<int64_t> keys_;
+  std::vector<StringView> labels_;
+  int64_t dense_base_;
+  std::vector<StringView> dense_labels_;
+};
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
+
+#endif  // ENUM_RESOLVER_HPP_
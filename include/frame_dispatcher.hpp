@@ -0,0 +1,103 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef FRAME_DISPATCHER_HPP_
+#define FRAME_DISPATCHER_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+struct UnknownIdCount
+{
+  unsigned int id;
+  uint64_t frame_count;
+};
+
+// Maps CAN IDs to codec indices of a Database. Standard IDs are looked
+// up directly in a table. Anything above that goes through a bitset
+// filter first, so most unknown extended IDs are rejected without
+// touching the hash map. dispatch() also counts frames with unknown
+// IDs for diagnostics. Lookups and counting are safe from any number
+// of threads.
+class FrameDispatcher
+{
+public:
+  static constexpr unsigned int STANDARD_ID_COUNT = 2048;
+  // Distinct unknown extended IDs counted individually. Further ones
+  // only show up in getUnknownFrameCount().
+  static constexpr size_t TRACKED_EXTENDED_IDS = 64;
+
+  FrameDispatcher();
+  // codec_ids[i] is the ID of the codec at index i
+  explicit FrameDispatcher(const std::vector<unsigned int> & codec_ids);
+
+  // Returns the codec index for the ID or -1
+  int32_t find(unsigned int msg_id) const;
+  // As find(), counting the frame if its ID is unknown
+  int32_t dispatch(unsigned int msg_id) const;
+  uint64_t getUnknownFrameCount() const;
+  // Unknown IDs seen by dispatch(), in ID order
+  std::vector<UnknownIdCount> getUnknownIdCounts() const;
+  // The counters are diagnostics rather than state, so resetting
+  // them doesn't need a non-const dispatcher.
+  void resetUnknownIdCounts() const;
+
+  friend class Database;
+
+private:
+  struct UnknownCounters
+  {
+    // Unknown extended IDs which didn't get a slot
+    std::atomic<uint64_t> untracked;
+    std::array<std::atomic<uint64_t>, STANDARD_ID_COUNT> standard;
+    // 0 marks a free slot, which no extended ID can be
+    std::array<std::atomic<unsigned int>, TRACKED_EXTENDED_IDS> extended_ids;
+    std::array<std::atomic<uint64_t>, TRACKED_EXTENDED_IDS> extended;
+  };
+
+  uint32_t filterBit(unsigned int msg_id) const;
+  void countUnknown(unsigned int msg_id) const;
+
+  std::vector<int32_t> standard_indices_;
+  std::vector<uint64_t> filter_;
+  unsigned int filter_shift_;
+  std::unordered_map<unsigned int, int32_t> extended_indices_;
+  // Heap allocated so the dispatcher stays movable
+  std::unique_ptr<UnknownCounters> unknown_;
+};
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
+
+#endif  // FRAME_DISPATCHER_HPP_
@@ -0,0 +1,86 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#ifndef LOOKUP_TABLE_HPP_
+#define LOOKUP_TABLE_HPP_
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+struct LookupTableConfig
+{
+  // Signals this many bits wide or narrower get a table
+  unsigned int max_length = 8;
+  // Cap on the combined size of all tables. Narrower signals are
+  // given tables first when it is reached.
+  size_t max_bytes = 1 << 20;
+};
+
+// Every physical value of a short signal, indexed by its raw bits
+using LookupTable = std::vector<double>;
+
+// The parts of a Signal which determine its physical values
+struct LookupTableKey
+{
+  unsigned int length;
+  bool is_signed;
+  double factor;
+  double offset;
+
+  bool operator<(const LookupTableKey & other) const;
+};
+
+// Tables of physical values for short signals, built once at load
+// time. Signals with the same width, sign and scaling share a table.
+class LookupTablePool
+{
+public:
+  LookupTablePool();
+
+  // Replaces any existing tables. Keys may repeat.
+  void build(std::vector<LookupTableKey> keys, const LookupTableConfig & config);
+  // Returns nullptr if the signal has no table
+  std::shared_ptr<const LookupTable> find(const LookupTableKey & key) const;
+  size_t size() const;
+  size_t getByteCount() const;
+
+  friend class Database;
+
+private:
+  std::map<LookupTableKey, std::shared_ptr<const LookupTable>> tables_;
+  size_t byte_count_;
+};
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
+
+#endif  // LOOKUP_TABLE_HPP_
@@ -22,10 +22,15 @@
 #define MESSAGE_HPP_
 
 #include "common_defs.hpp"
+#include "attribute.hpp"
 #include "bus_node.hpp"
 #include "comment.hpp"
+#include "e2e.hpp"
+#include "lookup_table.hpp"
 #include "signal.hpp"
+#include "signal_layout.hpp"
 
+#include <array>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -62,11 +67,29 @@ public:
   BusNode getTransmittingNode() const;
   std::unordered_map<std::string, const Signal *> getSignals() const;
   const std::string * getComment() const;
+  const SignalLayout * getLayout() const;
+  std::vector<const Signal *> getLayoutSignals() const;
+  size_t getContentHash() const;
+  size_t getAnnotationHash() const;
+  // The payload with every signal at its start value, see buildTemplate()
+  std::vector<uint8_t> getTemplateFrame() const;
+  // Counter and checksum signals. Loaded from the E2E* message
+  // attributes, see Database. Takes effect for transcoders and codecs
+  // created afterwards.
+  const E2EConfig & getE2EConfig() const;
+  // Throws DbcE2EConfigException and keeps the previous configuration
+  // if the new one doesn't fit the message
+  void setE2EConfig(const E2EConfig & config);
 
   static unsigned char dlcToLength(const unsigned char & dlc);
+  static unsigned char lengthToDlc(const unsigned char & length);
 
   friend class Database;
+  friend class DatabaseDiff;
+  friend class DatabaseTransaction;
+  friend class MessageCodec;
   friend class MessageTranscoder;
+  friend class VersionedDatabase;
 
 private:
   unsigned int id_;
@@ -75,26 +98,138 @@ private:
   BusNode transmitting_node_;
   std::unordered_map<std::string, Signal> signals_;
   std::unique_ptr<std::string> comment_;
-  
+  std::shared_ptr<const SignalLayout> layout_;
+  std::vector<const Signal *> layout_signals_;
+  size_t content_hash_;
+  size_t annotation_hash_;
+  // Raw start value per layout slot
+  std::vector<uint64_t> start_values_;
+  // Multiplexed messages only hold the page selected by the
+  // switches' start values
+  PaddedFrame template_frame_;
+  E2EConfig e2e_config_;
+
   void generateText() override;
   void parse() override;
+  SignalLayout buildLayout();
+  void updateHashes();
+  // Takes each signal's start value from its GenSigStartValue
+  // attribute, else the attribute's default in attribute_defs, else 0,
+  // and encodes them into template_frame_. Needs the layout.
+  void buildTemplate(const std::vector<std::unique_ptr<Attribute>> & attribute_defs);
+  // Replaces the E2EConfig with the one in the E2E* attribute values,
+  // if the message has any. Needs the layout.
+  void loadE2EConfig(const std::vector<std::unique_ptr<Attribute>> & attribute_defs);
 };
 
 class MessageTranscoder
 {
 public:
-  MessageTranscoder(Message * dbc_msg);
+  // Signals with a table in lookup_tables use it for getValue().
+  // message_index is the message's index in its Database's codecs,
+  // which handles passed to getSignal() must match.
+  MessageTranscoder(
+    Message * dbc_msg,
+    const LookupTablePool * lookup_tables = nullptr,
+    uint32_t message_index = SignalHandle::INVALID);
+  // Signal transcoders point back at their message's transcoder, so
+  // copies and moves have to rebind them
+  MessageTranscoder(const MessageTranscoder & other);
+  MessageTranscoder(MessageTranscoder && other);
+  MessageTranscoder & operator=(const MessageTranscoder & other);
+  MessageTranscoder & operator=(MessageTranscoder && other);
 
   const Message * getMessageDef();
-  void decode(std::vector<uint8_t> && raw_data, TranscodeError * err = nullptr);
+  // SignalHandle::INVALID unless made by Database::getTranscoders()
+  uint32_t getMessageIndex() const;
+  const SignalTranscoder * getSignal(const std::string & signal_name) const;
+  SignalTranscoder * getSignal(const std::string & signal_name);
+  // Slot lookups for handles resolved with getSlot() or
+  // Database::getSignalHandle(). Return nullptr for invalid slots and
+  // for handles of another message. Transcoders made without a message
+  // index only check the slot.
+  const SignalTranscoder * getSignal(const SignalHandle & handle) const;
+  SignalTranscoder * getSignal(const SignalHandle & handle);
+  // Returns -1 if the message has no such signal
+  int getSlot(const std::string & signal_name) const;
+  TranscodeErrorType decode(std::vector<uint8_t> && raw_data);
+  TranscodeErrorType decode(const uint8_t * frame, size_t frame_length);
+  TranscodeErrorType decode(const std::array<uint8_t, MAX_FRAME_LENGTH> & frame);
+  // Decodes only the signals whose bits differ from the previously
+  // decoded frame and fills changed_slots with their layout slots in
+  // ascending order. For multiplexed messages, signals which the
+  // multiplexer selects or deselects also count as changed. Every
+  // present signal is reported after construction or resetDelta().
+  TranscodeErrorType decodeDelta(
+    const uint8_t * frame,
+    size_t frame_length,
+    std::vector<uint32_t> & changed_slots);
+  // Makes the next decodeDelta() report every present signal
+  void resetDelta();
   std::vector<uint8_t> encode(TranscodeError * err = nullptr);
+  // Writes the current signal values into the first getLength()
+  // bytes of the frame. Bytes not covered by a signal are zeroed.
+  // Counter and checksum signals of the message's E2EConfig are filled
+  // in, whatever they were set to, and every encode advances the
+  // transmit counter.
+  // Signals start out at their start values (GenSigStartValue). Until
+  // the next decode, encoding copies the message's template frame and
+  // only inserts the signals which were set since, unless a
+  // multiplexer switch or a multiplexed signal was set.
+  TranscodeErrorType encode(uint8_t * frame, size_t frame_length);
+  TranscodeErrorType encode(std::array<uint8_t, MAX_FRAME_LENGTH> & frame);
+  // As encode(), applying policy to every signal which is written and
+  // outside its [min|max] range. If violations is given it is resized
+  // to violationMaskWords() and gets a bit for each of those signals,
+  // whatever the policy.
+  TranscodeErrorType encode(
+    uint8_t * frame,
+    size_t frame_length,
+    RangePolicy policy,
+    std::vector<uint64_t> * violations = nullptr);
+  // Sets a violation bit for every active signal outside its [min|max]
+  // range. Returns true if there are any.
+  bool validate(std::vector<uint64_t> & violations) const;
+  // Puts every signal back to its start value so that encoding goes
+  // back to patching the template frame
+  void resetToTemplate();
+  const E2EProfile & getE2EProfile() const;
+  // Result of checking the last decoded frame's checksum and counter.
+  // Always OK for messages without an E2EConfig.
+  E2EStatus getE2EStatus() const;
+  // Restarts the transmit counter at 0 and forgets the last received one
+  void resetE2E();
 
 private:
-  void decodeRawData(TranscodeError * err);
-
   Message * msg_def_;
+  uint32_t message_index_;
+  std::shared_ptr<const SignalLayout> layout_;
+  size_t length_;
   std::vector<uint8_t> data_;
-  std::unordered_map<std::string, SignalTranscoder> signal_xcoders_;
+  // Last decoded payload, kept for decodeDelta() and the E2E check
+  PaddedFrame last_frame_;
+  bool has_last_frame_;
+  // Scratch for decodeDelta() on multiplexed messages
+  std::vector<uint8_t> was_active_;
+  // Stored in layout slot order
+  std::vector<SignalTranscoder> signal_xcoders_;
+  std::unordered_map<std::string, size_t> signal_indices_;
+  // Slots set since construction or resetToTemplate(), in the order
+  // they were first set
+  std::vector<uint32_t> changed_slots_;
+  // False once a decode has replaced the start values
+  bool from_template_;
+  E2EProfile e2e_;
+  // Counter value for the next encode, advanced by every encode
+  // like the frame it goes into
+  uint64_t tx_counter_;
+  uint64_t rx_counter_;
+  bool has_rx_counter_;
+  E2EStatus e2e_status_;
+
+  void bindSignals();
+  void checkE2E();
+  void protect(PaddedFrame & padded_frame);
 };
 
 }  // namespace DbcLoader
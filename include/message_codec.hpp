@@ -0,0 +1,220 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef MESSAGE_CODEC_HPP_
+#define MESSAGE_CODEC_HPP_
+
+#include "common_defs.hpp"
+#include "bit_plan.hpp"
+#include "message.hpp"
+#include "signal_layout.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+// Immutable decoder/encoder for one message definition.
+// All per-frame state lives in the caller's Output, so a single
+// MessageCodec can be shared by any number of threads.
+class MessageCodec
+{
+public:
+  // Values for one frame, indexed by layout slot.
+  // Reusing an Output between frames avoids any allocation.
+  struct Output
+  {
+    std::vector<int64_t> raw_values;
+    std::vector<double> values;
+    // Non-zero for slots selected by the multiplexer. Unselected
+    // slots decode as zero and are skipped by encode().
+    std::vector<uint8_t> active;
+    // Only filled by DecodeSubset in DecodeMode::FIXED_POINT
+    std::vector<int64_t> fixed_values;
+    // Only filled by MessageCodec::validate(), see violationMaskWords()
+    std::vector<uint64_t> violations;
+
+    int64_t getRawValue(const SignalHandle & handle) const
+    {
+      return raw_values[handle.slot];
+    }
+
+    double getValue(const SignalHandle & handle) const
+    {
+      return values[handle.slot];
+    }
+
+    int64_t getFixedValue(const SignalHandle & handle) const
+    {
+      return fixed_values[handle.slot];
+    }
+
+    bool isActive(const SignalHandle & handle) const
+    {
+      return active[handle.slot] != 0;
+    }
+
+    bool isViolated(const SignalHandle & handle) const
+    {
+      return ((violations[handle.slot / 64] >> (handle.slot % 64)) & 1) != 0;
+    }
+  };
+
+  // Values for a batch of frames, one contiguous column per layout
+  // slot. Reusing a BatchOutput between calls avoids allocation once
+  // it has grown to the largest batch.
+  struct BatchOutput
+  {
+    size_t frame_count = 0;
+    std::vector<int64_t> raw_values;
+    std::vector<double> values;
+    // One column per slot like values, only filled for multiplexed
+    // messages. Empty means every slot is present in every frame.
+    std::vector<uint8_t> active;
+    // Only filled by MessageCodec::validateBatch(): violation_words
+    // words per frame, see violationMaskWords()
+    std::vector<uint64_t> violations;
+    size_t violation_words = 0;
+    // Zero-padded copies of the frames being decoded, laid out for the
+    // message length and pitch of the codec which last used them
+    std::vector<uint8_t> scratch;
+    size_t scratch_pitch = 0;
+    size_t scratch_length = 0;
+
+    const int64_t * getRawColumn(const SignalHandle & handle) const
+    {
+      return raw_values.data() + handle.slot * frame_count;
+    }
+
+    const double * getColumn(const SignalHandle & handle) const
+    {
+      return values.data() + handle.slot * frame_count;
+    }
+
+    // nullptr if every frame contains the signal
+    const uint8_t * getActiveColumn(const SignalHandle & handle) const
+    {
+      return active.empty() ? nullptr : active.data() + handle.slot * frame_count;
+    }
+
+    const uint64_t * getViolations(size_t frame_index) const
+    {
+      return violations.data() + frame_index * violation_words;
+    }
+
+    bool isViolated(const SignalHandle & handle, size_t frame_index) const
+    {
+      return ((getViolations(frame_index)[handle.slot / 64] >> (handle.slot % 64)) & 1) != 0;
+    }
+  };
+
+  // message_index is the message's index in its Database's codecs,
+  // which handles given to DecodeSubset must match.
+  MessageCodec(const Message & dbc_msg, uint32_t message_index = SignalHandle::INVALID);
+
+  unsigned int getId() const;
+  // SignalHandle::INVALID unless built by a Database
+  uint32_t getMessageIndex() const;
+  size_t getLength() const;
+  size_t getSignalCount() const;
+  const std::vector<std::string> & getSignalNames() const;
+  // Returns -1 if the message has no such signal
+  int getSlot(const std::string & signal_name) const;
+  const SignalLayout * getLayout() const;
+  // Disabled unless the message has an E2EConfig. Decoding doesn't
+  // check it: the counter state belongs to the caller, see
+  // E2EProfile::verifyChecksum() and E2EProfile::checkCounter().
+  const E2EProfile & getE2EProfile() const;
+
+  friend class Database;
+  friend class DecodeSubset;
+
+  // FLOAT and DOUBLE signals (SIG_VALTYPE_) have their raw bits in
+  // Output::raw_values and the reinterpreted value, scaled, in values.
+  TranscodeErrorType decode(const uint8_t * frame, size_t frame_length, Output & output) const;
+  // Decodes frame_count payloads of this message which start frame_stride
+  // bytes apart. Produces the same values as decode() on each frame.
+  // Multiplexed messages still extract every slot as a column and then
+  // mark the slots which weren't selected in BatchOutput::active.
+  TranscodeErrorType decodeBatch(
+    const uint8_t * frames,
+    size_t frame_count,
+    size_t frame_stride,
+    BatchOutput & output) const;
+  // As above for payloads which aren't evenly spaced, e.g. frames of
+  // this message picked out of a mixed batch. Each payload must be at
+  // least getLength() bytes.
+  TranscodeErrorType decodeBatch(
+    const uint8_t * const * frames,
+    size_t frame_count,
+    BatchOutput & output) const;
+  // Clamps each column of physical values to its signal's [min|max]
+  // range. Signals without a valid range are left alone.
+  void clampBatch(BatchOutput & output) const;
+  // Sets the violation bit of every present signal whose decoded value
+  // is outside its [min|max] range, NaN included. Returns true if any
+  // signal is out of range.
+  bool validate(Output & output) const;
+  // As validate() for each frame of a decoded batch, a column at a
+  // time. Returns the number of frames with at least one violation.
+  size_t validateBatch(BatchOutput & output) const;
+  // Encodes output.raw_values. Bytes not covered by a signal are zeroed.
+  // For multiplexed messages only the slots selected by the switch
+  // values in output.raw_values are written.
+  // The counter is taken from output.raw_values like any other signal
+  // and the checksum, if the message has one, is computed.
+  TranscodeErrorType encode(const Output & input, uint8_t * frame, size_t frame_length) const;
+
+private:
+  // frame_at(i) returns the payload of frame i
+  template<typename FrameAt>
+  void decodeColumns(FrameAt frame_at, size_t frame_count, BatchOutput & output) const;
+
+  unsigned int id_;
+  uint32_t message_index_;
+  size_t length_;
+  // Distance between frames in BatchOutput::scratch
+  size_t batch_pitch_;
+  std::shared_ptr<const SignalLayout> layout_;
+  std::vector<double> factors_;
+  std::vector<double> offsets_;
+  std::vector<double> mins_;
+  std::vector<double> maxs_;
+  std::vector<std::string> signal_names_;
+  std::unordered_map<std::string, int> slots_;
+  // Any slot with SignalValueType FLOAT or DOUBLE
+  bool has_ieee_slots_;
+  E2EProfile e2e_;
+};
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
+
+#endif  // MESSAGE_CODEC_HPP_
@@ -0,0 +1,134 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef MUX_TREE_HPP_
+#define MUX_TREE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+// When a layout slot is present in a frame: the slot holding the
+// multiplexer switch it depends on and the switch values which
+// select it. switch_slot is -1 for slots which are always present.
+struct MuxCondition
+{
+  int switch_slot = -1;
+  std::vector<std::pair<unsigned int, unsigned int>> ranges;
+
+  bool operator==(const MuxCondition & other) const;
+  bool operator!=(const MuxCondition & other) const;
+};
+
+// Precomputed decode order for a multiplexed layout.
+// Node 0 holds the slots which are always present. Every switch
+// slot maps its raw value to the node holding the slots selected by
+// that value, and those nodes can contain further switches
+// (extended multiplexing), forming a tree. Decoding walks only the
+// nodes selected by the frame, so unused mux pages cost nothing.
+class MuxTree
+{
+public:
+  MuxTree() = default;
+  MuxTree(const std::vector<MuxCondition> & conditions);
+
+  // False if every slot is always present
+  bool isMultiplexed() const;
+
+  // Calls visit(const uint32_t * slots, size_t count) for each group
+  // of slots present in a frame, switches before the slots they
+  // select. value_of(uint32_t slot) must return the raw value of a
+  // switch slot once that slot has been visited.
+  template<typename Visit, typename ValueOf>
+  void walk(Visit && visit, ValueOf && value_of) const
+  {
+    if (!nodes_.empty()) {
+      walkNode(0, visit, value_of);
+    }
+  }
+
+  friend class Database;
+
+private:
+  struct Node
+  {
+    std::vector<uint32_t> slots;
+    // Indices into switches_
+    std::vector<uint32_t> switches;
+  };
+
+  struct Switch
+  {
+    uint32_t slot;
+    // Node per raw value for small values, -1 where nothing is selected
+    std::vector<int32_t> table;
+    // Sorted interval starts and their nodes, used past the table
+    std::vector<uint64_t> starts;
+    std::vector<int32_t> nodes;
+
+    int32_t find(uint64_t value) const;
+  };
+
+  std::vector<Node> nodes_;
+  std::vector<Switch> switches_;
+
+  template<typename Visit, typename ValueOf>
+  void walkNode(size_t node_index, Visit & visit, ValueOf & value_of) const
+  {
+    const Node & node = nodes_[node_index];
+
+    visit(node.slots.data(), node.slots.size());
+
+    for (auto switch_index : node.switches) {
+      const Switch & mux_switch = switches_[switch_index];
+      int32_t child = mux_switch.find(static_cast<uint64_t>(value_of(mux_switch.slot)));
+
+      if (child >= 0) {
+        walkNode(static_cast<size_t>(child), visit, value_of);
+      }
+    }
+  }
+
+  void addSwitches(
+    size_t node_index,
+    const std::vector<std::vector<uint32_t>> & children,
+    const std::vector<MuxCondition> & conditions,
+    std::vector<int32_t> & switch_indices);
+  uint32_t buildSwitch(
+    uint32_t slot,
+    const std::vector<std::vector<uint32_t>> & children,
+    const std::vector<MuxCondition> & conditions,
+    std::vector<int32_t> & switch_indices);
+};
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
+
+#endif  // MUX_TREE_HPP_
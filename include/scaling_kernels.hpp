@@ -0,0 +1,76 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef SCALING_KERNELS_HPP_
+#define SCALING_KERNELS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+enum class SimdLevel
+{
+  SCALAR,
+  SSE4_2,
+  AVX2,
+  AVX512
+};
+
+// Column kernels for the raw-to-physical stages of decoding.
+// Every implementation produces bit-identical results: integer
+// conversion is correctly rounded, scaling is a separate multiply
+// and add (never fused), clamping keeps NaN values and range checks
+// count NaN as out of range.
+struct ScalingKernels
+{
+  SimdLevel level;
+
+  // values[i] = double(raw[i]) * factor + offset
+  void (* scaleSigned)(
+    const int64_t * raw, size_t count, double factor, double offset, double * values);
+  // As scaleSigned, with raw reinterpreted as unsigned
+  void (* scaleUnsigned)(
+    const int64_t * raw, size_t count, double factor, double offset, double * values);
+  // values[i] = min(max(values[i], min), max)
+  void (* clamp)(double * values, size_t count, double min, double max);
+  // masks[i * mask_stride] |= bit for every values[i] outside
+  // [min, max]. Returns the number of values flagged.
+  size_t (* flagRange)(
+    const double * values, size_t count, double min, double max,
+    uint64_t bit, uint64_t * masks, size_t mask_stride);
+};
+
+// Fastest kernels supported by the CPU, detected once at first use
+const ScalingKernels & getScalingKernels();
+// Returns nullptr if the CPU doesn't support the requested level
+const ScalingKernels * getScalingKernels(SimdLevel level);
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
+
+#endif  // SCALING_KERNELS_HPP_
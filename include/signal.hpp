@@ -23,11 +23,16 @@
 
 #include "common_defs.hpp"
 #include "bus_node.hpp"
+#include "bit_plan.hpp"
 #include "comment.hpp"
+#include "lookup_table.hpp"
+#include "signal_layout.hpp"
 
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace AS
@@ -46,7 +51,7 @@ public:
     std::string && name,
     bool is_multiplex_def,
     unsigned int multiplex_id,
-    unsigned char start_bit,
+    unsigned short start_bit,
     unsigned char length,
     Order endianness,
     bool is_signed,
@@ -67,10 +72,16 @@ public:
   std::string getName() const;
   bool isMultiplexDef() const;
   const unsigned int * getMultiplexId() const;
-  unsigned char getStartBit() const;
+  // Extended multiplexing (SG_MUL_VAL_). Empty when the signal uses
+  // the message's only multiplexer switch and its own multiplex ID.
+  std::string getMultiplexerName() const;
+  std::vector<std::pair<unsigned int, unsigned int>> getMultiplexRanges() const;
+  unsigned short getStartBit() const;
   unsigned char getLength() const;
   Order getEndianness() const;
   bool isSigned() const;
+  // INTEGER unless a SIG_VALTYPE_ line matched the signal's length
+  SignalValueType getValueType() const;
   float getFactor() const;
   float getOffset() const;
   float getMinVal() const;
@@ -79,18 +90,24 @@ public:
   std::vector<const BusNode *> getReceivingNodes() const;
   std::map<unsigned int, const std::string *> getValueDescriptions() const;
   const std::string * getComment() const;
+  SignalLayoutEntry getLayoutEntry() const;
+  size_t getContentHash() const;
 
   friend class Database;
+  friend class DatabaseDiff;
   friend class Message;
 
 private:
   std::string name_;
   bool is_multiplex_def_;
   std::unique_ptr<unsigned int> multiplex_id_;
-  unsigned char start_bit_;
+  std::string multiplexer_name_;
+  std::vector<std::pair<unsigned int, unsigned int>> multiplex_ranges_;
+  unsigned short start_bit_;
   unsigned char length_;
   Order endianness_;
   bool is_signed_;
+  SignalValueType value_type_;
   float factor_;
   float offset_;
   float min_;
@@ -107,10 +124,61 @@ private:
 class SignalTranscoder
 {
 public:
-  SignalTranscoder(Signal * dbc_sig);
+  SignalTranscoder(const Signal * dbc_sig, const BitPlan & plan);
+
+  const Signal * getSignalDef() const;
+  int64_t getRawValue() const;
+  // A single table load for signals with a LookupTable. Raw values
+  // set wider than the signal then read back as the value which
+  // would be encoded.
+  double getValue() const;
+  // False if the multiplexer didn't select this signal in the last
+  // decoded frame. Inactive signals are skipped when encoding.
+  bool isActive() const;
+  void setRawValue(int64_t raw_value);
+  // Converts to the raw value with a precomputed reciprocal factor,
+  // rounding to nearest and saturating to the signal's bit width.
+  // FLOAT and DOUBLE signals store the bits of the unscaled value.
+  void setValue(double value);
+  // False if the value is outside the signal's [min|max] range or NaN.
+  // Always true for signals without a range (min not below max).
+  bool isInRange() const;
+
+  friend class MessageTranscoder;
 
 private:
-  Signal * sig_def_;
+  const Signal * sig_def_;
+  BitPlan plan_;
+  bool is_signed_;
+  SignalValueType value_type_;
+  double factor_;
+  double offset_;
+  double inv_factor_;
+  double raw_min_;
+  double raw_max_;
+  // Physical range, only checked if has_range_
+  double min_;
+  double max_;
+  bool has_range_;
+  uint64_t raw_value_;
+  bool active_;
+  std::shared_ptr<const LookupTable> lookup_table_;
+  // lookup_table_->data(), or nullptr without a table
+  const double * lookup_values_;
+  // Owned by the MessageTranscoder, which records slot_ there the
+  // first time the value is set
+  std::vector<uint32_t> * changed_slots_;
+  uint32_t slot_;
+  bool changed_;
+  // Always present and not a multiplexer switch, so a new value can
+  // be patched into the message's template frame
+  bool patchable_;
+
+  void markChanged();
+  double toValue(uint64_t raw_value) const;
+  uint64_t toRaw(double value) const;
+  // The raw value nearest the current one whose value is in range
+  uint64_t getClampedRawValue() const;
 };
 
 }  // namespace DbcLoader
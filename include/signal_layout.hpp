@@ -0,0 +1,160 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef SIGNAL_LAYOUT_HPP_
+#define SIGNAL_LAYOUT_HPP_
+
+#include "common_defs.hpp"
+#include "bit_plan.hpp"
+#include "mux_tree.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+// The parts of a Signal which determine how it is decoded.
+// Names, units, receivers and comments are deliberately left out
+// so that messages which only differ in those can share a layout.
+struct SignalLayoutEntry
+{
+  unsigned short start_bit;
+  unsigned char length;
+  Order endianness;
+  bool is_signed;
+  SignalValueType value_type;
+  float factor;
+  float offset;
+  bool is_multiplex_def;
+  bool is_multiplexed;
+  unsigned int multiplex_id;
+
+  bool operator==(const SignalLayoutEntry & other) const;
+  bool operator!=(const SignalLayoutEntry & other) const;
+  bool operator<(const SignalLayoutEntry & other) const;
+};
+
+static constexpr size_t PAYLOAD_WORDS = MAX_FRAME_LENGTH / 8;
+
+// Payload bits as little-endian 64-bit words: bit i of word j is
+// bit i % 8 of byte 8 * j + i / 8
+using PayloadBitmap = std::array<uint64_t, PAYLOAD_WORDS>;
+
+// The payload bits of one signal in PayloadBitmap words.
+// A signal spans at most two consecutive words, word and word + 1.
+struct SignalMask
+{
+  uint32_t word;
+  uint64_t low;
+  uint64_t high;
+
+  bool intersects(const SignalMask & other) const;
+};
+
+// An immutable, ordered set of SignalLayoutEntry objects and the
+// BitPlan compiled for each of them. Multiplexed layouts also carry
+// a MuxCondition per slot and the MuxTree built from them; layouts
+// without multiplexing have no conditions.
+// The bits each slot occupies and the slots which overlap are worked
+// out once when the layout is built.
+// Messages with identical signal layouts share a single instance.
+class SignalLayout
+{
+public:
+  SignalLayout(
+    std::vector<SignalLayoutEntry> && entries,
+    std::vector<MuxCondition> && mux_conditions = std::vector<MuxCondition>());
+
+  const std::vector<SignalLayoutEntry> & getEntries() const;
+  const std::vector<BitPlan> & getPlans() const;
+  const std::vector<MuxCondition> & getMuxConditions() const;
+  const MuxTree & getMuxTree() const;
+  // Per slot. All zero for signals which don't fit in any frame.
+  const std::vector<SignalMask> & getSignalMasks() const;
+  // Every bit used by some slot, on any mux page
+  const PayloadBitmap & getOccupancy() const;
+  // Pairs of slots, lower slot first, which share bits and can be
+  // present in the same frame. Signals on different pages of a switch
+  // never are. Sorted.
+  const std::vector<std::pair<uint32_t, uint32_t>> & getOverlaps() const;
+  // True if the slot has bits at or past byte length, or doesn't fit
+  // in any frame at all
+  bool isOutOfBounds(uint32_t slot, size_t length) const;
+  size_t getHash() const;
+  bool operator==(const SignalLayout & other) const;
+
+  friend class Database;
+
+private:
+  std::vector<SignalLayoutEntry> entries_;
+  std::vector<BitPlan> plans_;
+  std::vector<MuxCondition> mux_conditions_;
+  MuxTree mux_tree_;
+  std::vector<SignalMask> masks_;
+  PayloadBitmap occupancy_;
+  std::vector<std::pair<uint32_t, uint32_t>> overlaps_;
+  size_t hash_;
+
+  void buildMasks();
+};
+
+// Stable reference to one signal of one message, resolved from names
+// once at setup. message_index selects a codec within a Database and
+// slot indexes that codec's Output arrays and MessageTranscoder slots.
+struct SignalHandle
+{
+  static constexpr uint32_t INVALID = UINT32_MAX;
+
+  uint32_t message_index = INVALID;
+  uint32_t slot = INVALID;
+
+  bool isValid() const
+  {
+    return message_index != INVALID && slot != INVALID;
+  }
+};
+
+class SignalLayoutPool
+{
+public:
+  std::shared_ptr<const SignalLayout> intern(SignalLayout && layout);
+  size_t size() const;
+
+  friend class Database;
+
+private:
+  std::unordered_multimap<size_t, std::shared_ptr<const SignalLayout>> layouts_;
+};
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
+
+#endif  // SIGNAL_LAYOUT_HPP_
@@ -0,0 +1,180 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef STRUCT_BINDING_HPP_
+#define STRUCT_BINDING_HPP_
+
+#include "common_defs.hpp"
+#include "bit_plan.hpp"
+#include "message.hpp"
+#include "message_codec.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+// Types a decoded signal can be written to
+enum class MemberType
+{
+  BOOL,
+  UINT8,
+  INT8,
+  UINT16,
+  INT16,
+  UINT32,
+  INT32,
+  UINT64,
+  INT64,
+  FLOAT,
+  DOUBLE
+};
+
+// MemberTypeOf<T>::value is the MemberType for a member of type T
+template<typename T>
+struct MemberTypeOf;
+
+template<>
+struct MemberTypeOf<bool> : std::integral_constant<MemberType, MemberType::BOOL> {};
+template<>
+struct MemberTypeOf<uint8_t> : std::integral_constant<MemberType, MemberType::UINT8> {};
+template<>
+struct MemberTypeOf<int8_t> : std::integral_constant<MemberType, MemberType::INT8> {};
+template<>
+struct MemberTypeOf<uint16_t> : std::integral_constant<MemberType, MemberType::UINT16> {};
+template<>
+struct MemberTypeOf<int16_t> : std::integral_constant<MemberType, MemberType::INT16> {};
+template<>
+struct MemberTypeOf<uint32_t> : std::integral_constant<MemberType, MemberType::UINT32> {};
+template<>
+struct MemberTypeOf<int32_t> : std::integral_constant<MemberType, MemberType::INT32> {};
+template<>
+struct MemberTypeOf<uint64_t> : std::integral_constant<MemberType, MemberType::UINT64> {};
+template<>
+struct MemberTypeOf<int64_t> : std::integral_constant<MemberType, MemberType::INT64> {};
+template<>
+struct MemberTypeOf<float> : std::integral_constant<MemberType, MemberType::FLOAT> {};
+template<>
+struct MemberTypeOf<double> : std::integral_constant<MemberType, MemberType::DOUBLE> {};
+
+// One member of a user struct and the signal decoded into it, e.g.
+// MemberBinding{"SPEED", offsetof(Status, speed), MemberTypeOf<float>::value}
+struct MemberBinding
+{
+  std::string signal_name;
+  size_t offset;
+  MemberType type;
+};
+
+// Signals of one message bound to the members of a trivially copyable
+// struct. Names are resolved once at construction, after which decode()
+// writes each member straight from the frame without any intermediate
+// container.
+//
+// Members get the signal's physical value converted to their type.
+// Integer members are rounded to nearest and saturate at the limits
+// of their type (NaN becomes 0). Signals with a factor of 1 and an
+// offset of 0 go from raw value to integer member without floating
+// point. bool members are true for any non-zero value other than
+// NaN. Members whose signal the multiplexer didn't select are set to
+// zero.
+class StructBinding
+{
+public:
+  // Throws DbcBindingException if a signal doesn't exist in the
+  // message or a member doesn't fit within struct_size bytes
+  StructBinding(
+    const MessageCodec & codec,
+    size_t struct_size,
+    const std::vector<MemberBinding> & members);
+  StructBinding(
+    const Message & dbc_msg,
+    size_t struct_size,
+    const std::vector<MemberBinding> & members);
+
+  unsigned int getId() const;
+  size_t getStructSize() const;
+  size_t getMemberCount() const;
+
+  // object must point to at least getStructSize() bytes
+  TranscodeErrorType decode(const uint8_t * frame, size_t frame_length, void * object) const;
+
+  // Returns INVALID_LENGTH if Struct is smaller than the bound size
+  template<typename Struct>
+  TranscodeErrorType decode(const uint8_t * frame, size_t frame_length, Struct & object) const
+  {
+    static_assert(
+      std::is_trivially_copyable<Struct>::value,
+      "StructBinding only writes to trivially copyable structs");
+
+    if (sizeof(Struct) < struct_size_) {
+      return TranscodeErrorType::INVALID_LENGTH;
+    }
+
+    return decode(frame, frame_length, static_cast<void *>(&object));
+  }
+
+private:
+  // A switch value which must be in one of ranges for a member's
+  // signal to be present
+  struct Condition
+  {
+    BitPlan plan;
+    std::vector<std::pair<unsigned int, unsigned int>> ranges;
+  };
+
+  // Extraction plans are kept in plans_, in entry order
+  struct Entry
+  {
+    size_t member_offset;
+    MemberType type;
+    SignalValueType value_type;
+    // Factor 1 and offset 0 on an integer signal
+    bool identity;
+    double factor;
+    double offset;
+    // Switches from the root down, empty if always present
+    std::vector<Condition> conditions;
+  };
+
+  unsigned int id_;
+  size_t length_;
+  size_t struct_size_;
+  std::vector<BitPlan> plans_;
+  std::vector<Entry> entries_;
+
+  void bind(const MessageCodec & codec, const std::vector<MemberBinding> & members);
+};
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
+
+#endif  // STRUCT_BINDING_HPP_
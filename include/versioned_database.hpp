@@ -0,0 +1,152 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef VERSIONED_DATABASE_HPP_
+#define VERSIONED_DATABASE_HPP_
+
+#include "common_defs.hpp"
+#include "attribute.hpp"
+#include "bus_node.hpp"
+#include "database.hpp"
+#include "message.hpp"
+#include "message_codec.hpp"
+#include "signal.hpp"
+#include "signal_layout.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+class VersionedDatabase;
+
+// An immutable view of a VersionedDatabase at a single revision.
+// Snapshots share every message which was not touched between
+// revisions so holding one is cheap.
+class DatabaseSnapshot
+{
+public:
+  uint64_t getRevision() const;
+  std::string getVersion() const;
+  std::string getBusConfig() const;
+  std::vector<const BusNode *> getBusNodes() const;
+  const Message * getMessage(unsigned int id) const;
+  std::unordered_map<unsigned int, const Message *> getMessages() const;
+  const MessageCodec * getCodec(unsigned int id) const;
+  std::vector<const Attribute *> getAttributeDefinitions() const;
+
+  friend class DatabaseTransaction;
+  friend class VersionedDatabase;
+
+private:
+  uint64_t revision_;
+  std::string version_;
+  std::string bus_config_;
+  std::shared_ptr<const std::vector<BusNode>> bus_nodes_;
+  std::shared_ptr<const std::vector<std::unique_ptr<Attribute>>> attribute_defs_;
+  std::unordered_map<unsigned int, std::shared_ptr<const Message>> messages_;
+  // Shared with earlier snapshots for unchanged messages
+  std::unordered_map<unsigned int, std::shared_ptr<const MessageCodec>> codecs_;
+};
+
+// A set of staged edits against the snapshot it was started from.
+// Nothing is visible to readers until commit() succeeds.
+class DatabaseTransaction
+{
+public:
+  void putMessage(Message && msg);
+  void removeMessage(unsigned int msg_id);
+  void putSignal(unsigned int msg_id, Signal && sig);
+  void removeSignal(unsigned int msg_id, const std::string & sig_name);
+  void setMessageAttribute(
+    unsigned int msg_id,
+    const std::string & attr_name,
+    std::string && value);
+  void setSignalAttribute(
+    unsigned int msg_id,
+    const std::string & sig_name,
+    const std::string & attr_name,
+    std::string && value);
+  const Message * getMessage(unsigned int msg_id) const;
+  // Throws DbcCommitConflictException if another transaction changed
+  // one of the same messages first, or DbcE2EConfigException if an
+  // edited message's E2E* attributes don't fit it. Nothing is
+  // published or lost in either case.
+  std::shared_ptr<const DatabaseSnapshot> commit();
+
+  friend class VersionedDatabase;
+
+private:
+  struct StagedMessage
+  {
+    std::shared_ptr<const Message> base;
+    std::shared_ptr<Message> edited;
+  };
+
+  DatabaseTransaction(
+    VersionedDatabase * db,
+    std::shared_ptr<const DatabaseSnapshot> && base);
+  Message & stage(unsigned int msg_id);
+  // Rebuilds a staged message's layout after its signals changed, so
+  // that getMessage() never exposes pointers to erased signals
+  void relayout(Message & msg);
+
+  VersionedDatabase * db_;
+  std::shared_ptr<const DatabaseSnapshot> base_;
+  std::unordered_map<unsigned int, StagedMessage> staged_;
+  bool committed_;
+};
+
+// Multi-version wrapper around a Database.
+// Readers take snapshots which are never invalidated by writers.
+// Writers stage edits in a DatabaseTransaction and publish them
+// atomically as a new revision. Concurrent transactions which touched
+// the same message are resolved first-committer-wins.
+class VersionedDatabase
+{
+public:
+  VersionedDatabase(Database && dbc);
+
+  std::shared_ptr<const DatabaseSnapshot> snapshot() const;
+  DatabaseTransaction beginTransaction();
+
+  friend class DatabaseTransaction;
+
+private:
+  std::shared_ptr<const DatabaseSnapshot> head_;
+  std::mutex commit_mutex_;
+  SignalLayoutPool layout_pool_;
+};
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
+
+#endif  // VERSIONED_DATABASE_HPP_
@@ -224,13 +224,13 @@ void EnumAttribute::parseTypeSpecificValues(std::istringstream & input)
     std::istringstream temp_stream(temp_string);
 
     while (std::getline(temp_stream, enum_val, ',')) {
-      enum_val = enum_val.substr(1, enum_val.length() - 2);
-
-      // Remove ending semicolon
-      if (enum_val[enum_val.length() - 1] == ';') {
-        enum_val = enum_val.substr(0, enum_val.length() - 1);
+      // Remove ending semicolon, then the quotes
+      if (!enum_val.empty() && enum_val[enum_val.length() - 1] == ';') {
+        enum_val.pop_back();
       }
 
+      enum_val = enum_val.substr(1, enum_val.length() - 2);
+
       enum_values_.emplace_back(std::move(enum_val));
     }
   } else {
@@ -0,0 +1,270 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "bit_plan.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+BitPlan::BitPlan(unsigned short start_bit, unsigned char length, Order endianness, bool is_signed)
+  : window(0),
+    shift(0),
+    big_endian(endianness == Order::BE),
+    end_byte(0),
+    mask(0),
+    sign_bit(0),
+    pext_mask(0)
+{
+  if (length == 0 || length > 64) {
+    return;
+  }
+
+  // Convert the sawtooth start bit (the MSB) of Motorola signals
+  // into a linear position counted from the MSB of byte 0
+  const unsigned int msb = (start_bit / 8) * 8 + (7 - start_bit % 8);
+  const unsigned int lsb = msb + length - 1;
+  const unsigned int last_bit = (big_endian ? lsb : start_bit + length - 1u);
+
+  // Signals which don't fit in the largest frame decode as zero.
+  // Checked before anything is narrowed to the plan's field widths.
+  if (last_bit / 8 + 1 > MAX_FRAME_LENGTH) {
+    return;
+  }
+
+  mask = (length == 64 ? ~0ULL : (1ULL << length) - 1);
+  sign_bit = (is_signed ? 1ULL << (length - 1) : 0);
+  end_byte = static_cast<uint8_t>(last_bit / 8 + 1);
+
+  if (big_endian) {
+    // Window ends on the byte holding the LSB
+    window = static_cast<int16_t>(lsb / 8) - 7;
+    shift = static_cast<uint8_t>(7 - lsb % 8);
+  } else {
+    // Window starts on the byte holding the LSB
+    window = static_cast<int16_t>(start_bit / 8);
+    shift = static_cast<uint8_t>(start_bit % 8);
+  }
+
+  if (shift + length <= 64) {
+    pext_mask = mask << shift;
+  }
+}
+
+namespace
+{
+
+// Begin shift-and-mask kernels
+
+void extractFrameShiftMask(
+  const BitPlan * plans, size_t count, const uint8_t * padded_frame, int64_t * raw)
+{
+  for (size_t i = 0; i < count; ++i) {
+    raw[i] = static_cast<int64_t>(plans[i].extract(padded_frame));
+  }
+}
+
+void insertFrameShiftMask(
+  const BitPlan * plans, size_t count, const int64_t * raw, uint8_t * padded_frame)
+{
+  for (size_t i = 0; i < count; ++i) {
+    plans[i].insert(padded_frame, static_cast<uint64_t>(raw[i]));
+  }
+}
+
+// Two passes: a gather of each frame's load window and spill byte,
+// then the shift/mask/sign-extend on contiguous arrays with every plan
+// field hoisted, which the compiler can vectorize.
+void extractColumnShiftMask(
+  const BitPlan & plan, const uint8_t * frames, size_t pitch, size_t frame_count,
+  int64_t * column)
+{
+  const uint8_t * window_ptr = frames + FRAME_PADDING + plan.window;
+  uint64_t words[MAX_COLUMN_CHUNK];
+  uint64_t spills[MAX_COLUMN_CHUNK];
+
+  if (plan.big_endian) {
+    for (size_t i = 0; i < frame_count; ++i) {
+      words[i] = loadBe64(window_ptr + i * pitch);
+      spills[i] = window_ptr[i * pitch - 1];
+    }
+  } else {
+    for (size_t i = 0; i < frame_count; ++i) {
+      words[i] = loadLe64(window_ptr + i * pitch);
+      spills[i] = window_ptr[i * pitch + 8];
+    }
+  }
+
+  const uint64_t mask = plan.mask;
+  const uint64_t sign_bit = plan.sign_bit;
+  const unsigned int shift = plan.shift;
+  const unsigned int spill_shift = 63 - shift;
+
+  for (size_t i = 0; i < frame_count; ++i) {
+    uint64_t raw = ((words[i] >> shift) | (spills[i] << 1 << spill_shift)) & mask;
+    column[i] = static_cast<int64_t>((raw ^ sign_bit) - sign_bit);
+  }
+}
+
+// End shift-and-mask kernels
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define DBC_LOADER_BMI2_KERNELS
+
+// Begin BMI2 kernels
+
+__attribute__((target("bmi2")))
+inline uint64_t loadWindow(const BitPlan & plan, const uint8_t * padded_frame)
+{
+  const uint8_t * window_ptr = padded_frame + FRAME_PADDING + plan.window;
+  return (plan.big_endian ? loadBe64(window_ptr) : loadLe64(window_ptr));
+}
+
+__attribute__((target("bmi2")))
+void extractFrameBmi2(
+  const BitPlan * plans, size_t count, const uint8_t * padded_frame, int64_t * raw)
+{
+  for (size_t i = 0; i < count; ++i) {
+    const BitPlan & plan = plans[i];
+
+    if (plan.pext_mask != 0) {
+      uint64_t value = __builtin_ia32_pext_di(loadWindow(plan, padded_frame), plan.pext_mask);
+      raw[i] = static_cast<int64_t>((value ^ plan.sign_bit) - plan.sign_bit);
+    } else {
+      raw[i] = static_cast<int64_t>(plan.extract(padded_frame));
+    }
+  }
+}
+
+__attribute__((target("bmi2")))
+void insertFrameBmi2(
+  const BitPlan * plans, size_t count, const int64_t * raw, uint8_t * padded_frame)
+{
+  for (size_t i = 0; i < count; ++i) {
+    const BitPlan & plan = plans[i];
+
+    if (plan.pext_mask != 0) {
+      uint8_t * window_ptr = padded_frame + FRAME_PADDING + plan.window;
+      uint64_t word = loadWindow(plan, padded_frame);
+      word = (word & ~plan.pext_mask) |
+        __builtin_ia32_pdep_di(static_cast<uint64_t>(raw[i]), plan.pext_mask);
+
+      if (plan.big_endian) {
+        storeBe64(window_ptr, word);
+      } else {
+        storeLe64(window_ptr, word);
+      }
+    } else {
+      plan.insert(padded_frame, static_cast<uint64_t>(raw[i]));
+    }
+  }
+}
+
+__attribute__((target("bmi2")))
+void extractColumnBmi2(
+  const BitPlan & plan, const uint8_t * frames, size_t pitch, size_t frame_count,
+  int64_t * column)
+{
+  if (plan.pext_mask == 0) {
+    extractColumnShiftMask(plan, frames, pitch, frame_count, column);
+    return;
+  }
+
+  const uint8_t * window_ptr = frames + FRAME_PADDING + plan.window;
+  const uint64_t pext_mask = plan.pext_mask;
+  const uint64_t sign_bit = plan.sign_bit;
+
+  if (plan.big_endian) {
+    for (size_t i = 0; i < frame_count; ++i) {
+      uint64_t value = __builtin_ia32_pext_di(loadBe64(window_ptr + i * pitch), pext_mask);
+      column[i] = static_cast<int64_t>((value ^ sign_bit) - sign_bit);
+    }
+  } else {
+    for (size_t i = 0; i < frame_count; ++i) {
+      uint64_t value = __builtin_ia32_pext_di(loadLe64(window_ptr + i * pitch), pext_mask);
+      column[i] = static_cast<int64_t>((value ^ sign_bit) - sign_bit);
+    }
+  }
+}
+
+// End BMI2 kernels
+
+#endif  // x86 with GCC-compatible compiler
+
+const BitPlanKernels SHIFT_MASK_KERNELS =
+{BitPlanBackend::SHIFT_MASK, extractFrameShiftMask, insertFrameShiftMask, extractColumnShiftMask};
+
+#ifdef DBC_LOADER_BMI2_KERNELS
+const BitPlanKernels BMI2_KERNELS =
+{BitPlanBackend::BMI2, extractFrameBmi2, insertFrameBmi2, extractColumnBmi2};
+#endif
+
+const BitPlanKernels & selectBitPlanKernels()
+{
+  auto kernels = getBitPlanKernels(BitPlanBackend::BMI2);
+
+#ifdef DBC_LOADER_BMI2_KERNELS
+  // Zen and Zen 2 implement PEXT/PDEP in microcode with a latency of
+  // hundreds of cycles, far slower than shifting.
+  if (__builtin_cpu_is("znver1") || __builtin_cpu_is("znver2")) {
+    kernels = nullptr;
+  }
+#endif
+
+  return (kernels != nullptr ? *kernels : SHIFT_MASK_KERNELS);
+}
+
+}  // namespace
+
+const BitPlanKernels & getBitPlanKernels()
+{
+  static const BitPlanKernels & kernels = selectBitPlanKernels();
+  return kernels;
+}
+
+const BitPlanKernels * getBitPlanKernels(BitPlanBackend backend)
+{
+  switch (backend) {
+    case BitPlanBackend::SHIFT_MASK:
+      return &SHIFT_MASK_KERNELS;
+    case BitPlanBackend::BMI2:
+#ifdef DBC_LOADER_BMI2_KERNELS
+      __builtin_cpu_init();
+
+      if (__builtin_cpu_supports("bmi2")) {
+        return &BMI2_KERNELS;
+      }
+#endif
+      return nullptr;
+  }
+
+  return nullptr;
+}
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
@@ -36,9 +36,10 @@ BusNode::BusNode(std::string && node_name)
 }
 
 BusNode::BusNode(const BusNode & other)
-  : name_(other.name_)
+  : AttrObj(other),
+    name_(other.name_)
 {
-  if (comment_) {
+  if (other.comment_) {
     comment_ = std::make_unique<std::string>(*(other.comment_));
   } else {
     comment_ = nullptr;
@@ -23,13 +23,18 @@
 #include <algorithm>
 #include <cstring>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <map>
 #include <memory>
 #include <string>
 #include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace AS
@@ -39,6 +44,142 @@ namespace CAN
 namespace DbcLoader
 {
 
+namespace
+{
+
+// Node layouts below follow the common node-based standard library
+// implementations: a singly-linked node (plus a cached hash for non-integral
+// keys) for unordered containers and a red-black node for ordered ones.
+constexpr size_t alignUp(size_t size)
+{
+  return (size + alignof(void *) - 1) & ~(alignof(void *) - 1);
+}
+
+void addAllocation(MemoryUsage::Category & category, size_t bytes)
+{
+  category.bytes += bytes;
+  category.allocations++;
+}
+
+void addString(MemoryUsage::Category & category, const std::string & str)
+{
+  auto obj_begin = reinterpret_cast<const char *>(&str);
+  auto obj_end = obj_begin + sizeof(std::string);
+
+  // Strings which fit in the small-string buffer don't allocate
+  if (str.data() < obj_begin || str.data() >= obj_end) {
+    addAllocation(category, str.capacity() + 1);
+  }
+}
+
+void addString(MemoryUsage::Category & category, const std::unique_ptr<std::string> & str)
+{
+  if (str) {
+    addAllocation(category, sizeof(std::string));
+    addString(category, *str);
+  }
+}
+
+template<typename T>
+void addVector(MemoryUsage::Category & category, const std::vector<T> & vec)
+{
+  if (vec.capacity() > 0) {
+    addAllocation(category, vec.capacity() * sizeof(T));
+  }
+}
+
+template<typename Map>
+void addHashMap(MemoryUsage::Category & category, const Map & map)
+{
+  constexpr bool cached_hash = !std::is_integral<typename Map::key_type>::value;
+  constexpr size_t node_size =
+    sizeof(void *) + alignUp(sizeof(typename Map::value_type)) +
+    (cached_hash ? sizeof(size_t) : 0);
+
+  category.bytes += map.size() * node_size;
+  category.allocations += map.size();
+
+  // A single bucket is stored inline in the container
+  if (map.bucket_count() > 1) {
+    addAllocation(category, map.bucket_count() * sizeof(void *));
+  }
+}
+
+template<typename Map>
+void addTreeMap(MemoryUsage::Category & category, const Map & map)
+{
+  constexpr size_t node_size =
+    alignUp(sizeof(int)) + 3 * sizeof(void *) + alignUp(sizeof(typename Map::value_type));
+
+  category.bytes += map.size() * node_size;
+  category.allocations += map.size();
+}
+
+void addAttrValues(
+  MemoryUsage::Category & category,
+  const std::unordered_map<std::string, std::string> & values)
+{
+  addHashMap(category, values);
+
+  for (const auto & value : values) {
+    addString(category, value.first);
+    addString(category, value.second);
+  }
+}
+
+// A parsed VAL_ line for a signal
+struct SignalValueList
+{
+  unsigned int msg_id;
+  std::string signal_name;
+  std::map<unsigned int, std::string> value_descs;
+};
+
+// A parsed SG_MUL_VAL_ line
+struct ExtendedMux
+{
+  unsigned int msg_id;
+  std::string signal_name;
+  std::string switch_name;
+  std::vector<std::pair<unsigned int, unsigned int>> ranges;
+};
+
+// A parsed BA_ line for a bus node, message or signal
+struct AttributeValueDef
+{
+  DbcObjType obj_type;
+  std::string attr_name;
+  std::string node_name;
+  unsigned int msg_id;
+  std::string signal_name;
+  std::string value;
+};
+
+// A parsed SIG_VALTYPE_ line
+struct SignalValueTypeDef
+{
+  unsigned int msg_id;
+  std::string signal_name;
+  SignalValueType value_type;
+};
+
+}  // namespace
+
+MemoryUsage::Category MemoryUsage::total() const
+{
+  Category sum;
+
+  for (const auto & category : {
+      messages, signals, bus_nodes, comments, attribute_definitions,
+      attribute_values, value_tables, signal_layouts, codecs, lookup_tables, dbc_text})
+  {
+    sum.bytes += category.bytes;
+    sum.allocations += category.allocations;
+  }
+
+  return sum;
+}
+
 Database::Database(const std::string & dbc_path)
 {
   std::ifstream file_reader;
@@ -82,6 +223,16 @@ Database::Database(
       attribute_defs_.emplace_back(std::move(dynamic_cast<StringAttribute *>(attr)));
     }
   }
+
+  for (auto & msg : messages_) {
+    msg.second.layout_ = layout_pool_.intern(msg.second.buildLayout());
+    msg.second.updateHashes();
+    msg.second.buildTemplate(attribute_defs_);
+    msg.second.loadE2EConfig(attribute_defs_);
+  }
+
+  buildCodecs();
+  buildLookupTables(LookupTableConfig());
 }
 
 std::string Database::getVersion() const
@@ -150,6 +301,11 @@ std::vector<const Attribute *> Database::getAttributeDefinitions() const
   return temp_attr_defs;
 }
 
+size_t Database::getSignalLayoutCount() const
+{
+  return layout_pool_.size();
+}
+
 void Database::writeDbcToFile(const std::string & dbc_path) const
 {
   std::ofstream file_writer;
@@ -174,12 +330,535 @@ std::unordered_map<unsigned int, MessageTranscoder> Database::getTranscoders()
   std::unordered_map<unsigned int, MessageTranscoder> xcoders;
 
   for (auto msg = messages_.begin(); msg != messages_.end(); ++msg) {
-    xcoders.emplace(msg->first, &(msg->second));
+    xcoders.emplace(
+      std::piecewise_construct,
+      std::forward_as_tuple(msg->first),
+      std::forward_as_tuple(
+        &(msg->second), &lookup_tables_, static_cast<uint32_t>(dispatcher_.find(msg->first))));
   }
 
   return xcoders;
 }
 
+const MessageCodec * Database::getCodec(unsigned int msg_id) const
+{
+  int32_t message_index = dispatcher_.find(msg_id);
+
+  if (message_index >= 0) {
+    return &(codecs_[message_index]);
+  }
+
+  return nullptr;
+}
+
+const MessageCodec * Database::dispatch(unsigned int msg_id) const
+{
+  int32_t message_index = dispatcher_.dispatch(msg_id);
+
+  if (message_index >= 0) {
+    return &(codecs_[message_index]);
+  }
+
+  return nullptr;
+}
+
+const FrameDispatcher & Database::getDispatcher() const
+{
+  return dispatcher_;
+}
+
+const MessageCodec * Database::getCodec(const SignalHandle & handle) const
+{
+  return getCodecAt(handle.message_index);
+}
+
+size_t Database::getCodecCount() const
+{
+  return codecs_.size();
+}
+
+const MessageCodec * Database::getCodecAt(size_t message_index) const
+{
+  if (message_index < codecs_.size()) {
+    return &(codecs_[message_index]);
+  }
+
+  return nullptr;
+}
+
+SignalHandle Database::getSignalHandle(unsigned int msg_id, const std::string & signal_name) const
+{
+  SignalHandle handle;
+  int32_t message_index = dispatcher_.find(msg_id);
+
+  if (message_index >= 0) {
+    int slot = codecs_[message_index].getSlot(signal_name);
+
+    if (slot >= 0) {
+      handle.message_index = static_cast<uint32_t>(message_index);
+      handle.slot = static_cast<uint32_t>(slot);
+    }
+  }
+
+  return handle;
+}
+
+void Database::setLookupTableConfig(const LookupTableConfig & config)
+{
+  buildLookupTables(config);
+}
+
+size_t Database::getLookupTableCount() const
+{
+  return lookup_tables_.size();
+}
+
+void Database::buildLookupTables(const LookupTableConfig & config)
+{
+  std::vector<LookupTableKey> keys;
+
+  for (const auto & msg : messages_) {
+    for (const auto & sig : msg.second.signals_) {
+      // Tables are indexed by integer raw values
+      if (sig.second.value_type_ != SignalValueType::INTEGER) {
+        continue;
+      }
+
+      keys.push_back(
+        LookupTableKey{
+          sig.second.getLength(), sig.second.isSigned(),
+          sig.second.getFactor(), sig.second.getOffset()});
+    }
+  }
+
+  lookup_tables_.build(std::move(keys), config);
+}
+
+const EnumResolver * Database::getEnumResolver(const SignalHandle & handle) const
+{
+  if (handle.message_index < enum_resolver_indices_.size()) {
+    const auto & indices = enum_resolver_indices_[handle.message_index];
+
+    if (handle.slot < indices.size() && indices[handle.slot] >= 0) {
+      return &(enum_resolvers_[indices[handle.slot]]);
+    }
+  }
+
+  return nullptr;
+}
+
+void Database::decodeBatch(
+  const CanFrame * frames,
+  size_t frame_count,
+  FrameOrder order,
+  MixedBatchOutput & output) const
+{
+  // message_groups maps a codec index to its group in this batch, or -1.
+  // Entries set here are reset before returning so it stays all -1.
+  if (output.message_groups.size() != codecs_.size()) {
+    output.message_groups.assign(codecs_.size(), -1);
+  }
+
+  output.frame_groups.resize(frame_count);
+  output.group_count = 0;
+  output.skipped = 0;
+
+  // First pass: resolve each frame's codec and collect the messages seen
+  for (size_t i = 0; i < frame_count; ++i) {
+    const CanFrame & frame = frames[i];
+    const int32_t message_index = dispatcher_.dispatch(frame.id);
+
+    if (message_index < 0 ||
+      frame.length > MAX_FRAME_LENGTH ||
+      frame.length < codecs_[message_index].getLength())
+    {
+      output.frame_groups[i] = -1;
+      ++output.skipped;
+      continue;
+    }
+
+    output.frame_groups[i] = message_index;
+
+    if (output.message_groups[message_index] < 0) {
+      output.message_groups[message_index] = 0;
+
+      if (output.groups.size() <= output.group_count) {
+        output.groups.emplace_back();
+      }
+
+      output.groups[output.group_count++].message_index = static_cast<uint32_t>(message_index);
+    }
+  }
+
+  auto groups_end = output.groups.begin() + output.group_count;
+
+  std::sort(
+    output.groups.begin(), groups_end,
+    [](const MixedBatchOutput::Group & a, const MixedBatchOutput::Group & b)
+    {
+      return a.message_index < b.message_index;
+    });
+
+  for (size_t g = 0; g < output.group_count; ++g) {
+    output.message_groups[output.groups[g].message_index] = static_cast<int32_t>(g);
+    output.groups[g].frame_count = 0;
+  }
+
+  // Counting sort by group, which keeps frames of a group in input order
+  for (size_t i = 0; i < frame_count; ++i) {
+    if (output.frame_groups[i] >= 0) {
+      int32_t group = output.message_groups[output.frame_groups[i]];
+      output.frame_groups[i] = group;
+      ++output.groups[group].frame_count;
+    }
+  }
+
+  size_t decoded_count = 0;
+
+  for (size_t g = 0; g < output.group_count; ++g) {
+    output.groups[g].first = decoded_count;
+    decoded_count += output.groups[g].frame_count;
+    output.groups[g].frame_count = 0;
+  }
+
+  output.frame_order.resize(decoded_count);
+  output.payloads.resize(decoded_count);
+  output.rows.clear();
+  output.rows.reserve(decoded_count);
+
+  for (size_t i = 0; i < frame_count; ++i) {
+    const int32_t group = output.frame_groups[i];
+
+    if (group < 0) {
+      continue;
+    }
+
+    auto & target = output.groups[group];
+    const size_t row = target.frame_count++;
+
+    output.frame_order[target.first + row] = i;
+    output.payloads[target.first + row] = frames[i].data.data();
+
+    if (order == FrameOrder::ORIGINAL) {
+      output.rows.push_back(
+        {i, static_cast<uint32_t>(group), static_cast<uint32_t>(row), frames[i].timestamp});
+    }
+  }
+
+  for (size_t g = 0; g < output.group_count; ++g) {
+    auto & group = output.groups[g];
+
+    codecs_[group.message_index].decodeBatch(
+      output.payloads.data() + group.first, group.frame_count, group.batch);
+    output.message_groups[group.message_index] = -1;
+
+    if (order == FrameOrder::GROUPED) {
+      for (size_t row = 0; row < group.frame_count; ++row) {
+        const size_t frame_index = output.frame_order[group.first + row];
+
+        output.rows.push_back(
+          {frame_index, static_cast<uint32_t>(g), static_cast<uint32_t>(row),
+            frames[frame_index].timestamp});
+      }
+    }
+  }
+}
+
+std::vector<LayoutIssue> Database::validateLayouts() const
+{
+  std::vector<LayoutIssue> issues;
+
+  for (uint32_t message_index = 0; message_index < codecs_.size(); ++message_index) {
+    const MessageCodec & codec = codecs_[message_index];
+    const SignalLayout & layout = *(codec.layout_);
+    SignalHandle signal;
+    SignalHandle other_signal;
+    signal.message_index = message_index;
+    other_signal.message_index = message_index;
+
+    for (uint32_t slot = 0; slot < layout.getPlans().size(); ++slot) {
+      if (layout.isOutOfBounds(slot, codec.length_)) {
+        signal.slot = slot;
+        issues.push_back(
+          LayoutIssue{LayoutIssueType::OUT_OF_BOUNDS, codec.id_, signal, SignalHandle()});
+      }
+    }
+
+    for (const auto & overlap : layout.getOverlaps()) {
+      signal.slot = overlap.second;
+      other_signal.slot = overlap.first;
+      issues.push_back(LayoutIssue{LayoutIssueType::OVERLAP, codec.id_, signal, other_signal});
+    }
+  }
+
+  return issues;
+}
+
+void Database::buildEnumResolvers()
+{
+  // Signals commonly share a value table, so identical resolvers are
+  // only kept once
+  std::map<
+    std::pair<std::vector<int64_t>, std::vector<std::pair<size_t, size_t>>>,
+    int32_t> resolver_indices;
+
+  label_pool_ = LabelPool();
+  enum_resolvers_.clear();
+  enum_resolver_indices_.assign(codecs_.size(), std::vector<int32_t>());
+
+  for (size_t message_index = 0; message_index < codecs_.size(); ++message_index) {
+    const Message & msg = messages_.at(codecs_[message_index].getId());
+    auto & indices = enum_resolver_indices_[message_index];
+
+    indices.assign(msg.layout_signals_.size(), -1);
+
+    for (size_t slot = 0; slot < msg.layout_signals_.size(); ++slot) {
+      const Signal * sig = msg.layout_signals_[slot];
+
+      if (sig->value_descs_.empty()) {
+        continue;
+      }
+
+      EnumResolver resolver(sig->value_descs_, sig->length_, sig->is_signed_, label_pool_);
+      auto inserted = resolver_indices.emplace(
+        std::make_pair(resolver.keys_, resolver.label_refs_),
+        static_cast<int32_t>(enum_resolvers_.size()));
+
+      if (inserted.second) {
+        enum_resolvers_.push_back(std::move(resolver));
+      }
+
+      indices[slot] = inserted.first->second;
+    }
+  }
+
+  // Views can only be taken once the pool stops growing
+  for (auto & resolver : enum_resolvers_) {
+    resolver.finalize(label_pool_);
+  }
+
+  label_pool_.offsets_.clear();
+}
+
+void Database::buildCodecs()
+{
+  std::vector<unsigned int> ids;
+  ids.reserve(messages_.size());
+
+  for (const auto & msg : messages_) {
+    ids.push_back(msg.first);
+  }
+
+  // Keep codec order independent of hash map iteration order
+  std::sort(ids.begin(), ids.end());
+
+  codecs_.clear();
+  codecs_.reserve(ids.size());
+
+  for (size_t i = 0; i < ids.size(); ++i) {
+    codecs_.emplace_back(messages_.at(ids[i]), static_cast<uint32_t>(i));
+  }
+
+  dispatcher_ = FrameDispatcher(ids);
+
+  buildEnumResolvers();
+}
+
+MemoryUsage Database::memoryUsage() const
+{
+  MemoryUsage usage;
+
+  addString(usage.dbc_text, version_);
+  addString(usage.dbc_text, bus_config_);
+
+  addVector(usage.bus_nodes, bus_nodes_);
+
+  for (const auto & node : bus_nodes_) {
+    addString(usage.bus_nodes, node.name_);
+    addString(usage.comments, node.comment_);
+    addAttrValues(usage.attribute_values, node.attribute_values_);
+  }
+
+  addHashMap(usage.messages, messages_);
+
+  for (const auto & msg_pair : messages_) {
+    const auto & msg = msg_pair.second;
+
+    addString(usage.messages, msg.name_);
+    addString(usage.messages, msg.transmitting_node_.name_);
+    addString(usage.comments, msg.transmitting_node_.comment_);
+    addString(usage.comments, msg.comment_);
+    addString(usage.dbc_text, msg.dbc_text_);
+    addAttrValues(usage.attribute_values, msg.attribute_values_);
+    addAttrValues(usage.attribute_values, msg.transmitting_node_.attribute_values_);
+
+    addVector(usage.signal_layouts, msg.layout_signals_);
+    addHashMap(usage.signals, msg.signals_);
+    addVector(usage.messages, msg.start_values_);
+    addString(usage.messages, msg.e2e_config_.counter_signal);
+    addString(usage.messages, msg.e2e_config_.checksum_signal);
+
+    for (const auto & sig_pair : msg.signals_) {
+      const auto & sig = sig_pair.second;
+
+      addString(usage.signals, sig_pair.first);
+      addString(usage.signals, sig.name_);
+      addString(usage.signals, sig.unit_);
+      addString(usage.signals, sig.multiplexer_name_);
+      addVector(usage.signals, sig.multiplex_ranges_);
+      addVector(usage.signals, sig.receiving_nodes_);
+
+      if (sig.multiplex_id_) {
+        addAllocation(usage.signals, sizeof(unsigned int));
+      }
+
+      for (const auto & node : sig.receiving_nodes_) {
+        addString(usage.signals, node.name_);
+        addString(usage.comments, node.comment_);
+        addAttrValues(usage.attribute_values, node.attribute_values_);
+      }
+
+      addString(usage.comments, sig.comment_);
+      addString(usage.dbc_text, sig.dbc_text_);
+      addAttrValues(usage.attribute_values, sig.attribute_values_);
+
+      addTreeMap(usage.value_tables, sig.value_descs_);
+
+      for (const auto & desc : sig.value_descs_) {
+        addString(usage.value_tables, desc.second);
+      }
+    }
+  }
+
+  addHashMap(usage.signal_layouts, layout_pool_.layouts_);
+
+  for (const auto & layout : layout_pool_.layouts_) {
+    // Layouts are created with std::make_shared, which places the
+    // reference counts and the object in a single allocation
+    addAllocation(usage.signal_layouts, sizeof(void *) + 2 * sizeof(int) + sizeof(SignalLayout));
+    addVector(usage.signal_layouts, layout.second->entries_);
+    addVector(usage.signal_layouts, layout.second->plans_);
+    addVector(usage.signal_layouts, layout.second->mux_conditions_);
+    addVector(usage.signal_layouts, layout.second->masks_);
+    addVector(usage.signal_layouts, layout.second->overlaps_);
+
+    for (const auto & condition : layout.second->mux_conditions_) {
+      addVector(usage.signal_layouts, condition.ranges);
+    }
+
+    const auto & mux_tree = layout.second->mux_tree_;
+    addVector(usage.signal_layouts, mux_tree.nodes_);
+    addVector(usage.signal_layouts, mux_tree.switches_);
+
+    for (const auto & node : mux_tree.nodes_) {
+      addVector(usage.signal_layouts, node.slots);
+      addVector(usage.signal_layouts, node.switches);
+    }
+
+    for (const auto & mux_switch : mux_tree.switches_) {
+      addVector(usage.signal_layouts, mux_switch.table);
+      addVector(usage.signal_layouts, mux_switch.starts);
+      addVector(usage.signal_layouts, mux_switch.nodes);
+    }
+  }
+
+  addVector(usage.value_tables, label_pool_.chars_);
+  addTreeMap(usage.value_tables, label_pool_.offsets_);
+  addVector(usage.value_tables, enum_resolvers_);
+  addVector(usage.value_tables, enum_resolver_indices_);
+
+  for (const auto & resolver : enum_resolvers_) {
+    addVector(usage.value_tables, resolver.label_refs_);
+    addVector(usage.value_tables, resolver.keys_);
+    addVector(usage.value_tables, resolver.labels_);
+    addVector(usage.value_tables, resolver.dense_labels_);
+  }
+
+  for (const auto & indices : enum_resolver_indices_) {
+    addVector(usage.value_tables, indices);
+  }
+
+  addTreeMap(usage.lookup_tables, lookup_tables_.tables_);
+
+  for (const auto & table : lookup_tables_.tables_) {
+    // Created with std::make_shared, see the layouts above
+    addAllocation(usage.lookup_tables, sizeof(void *) + 2 * sizeof(int) + sizeof(LookupTable));
+    addVector(usage.lookup_tables, *(table.second));
+  }
+
+  addVector(usage.codecs, codecs_);
+  addVector(usage.codecs, dispatcher_.standard_indices_);
+  addVector(usage.codecs, dispatcher_.filter_);
+  addHashMap(usage.codecs, dispatcher_.extended_indices_);
+  addAllocation(usage.codecs, sizeof(FrameDispatcher::UnknownCounters));
+
+  for (const auto & codec : codecs_) {
+    addVector(usage.codecs, codec.factors_);
+    addVector(usage.codecs, codec.offsets_);
+    addVector(usage.codecs, codec.mins_);
+    addVector(usage.codecs, codec.maxs_);
+    addVector(usage.codecs, codec.signal_names_);
+    addHashMap(usage.codecs, codec.slots_);
+
+    for (const auto & name : codec.signal_names_) {
+      addString(usage.codecs, name);
+    }
+
+    for (const auto & slot : codec.slots_) {
+      addString(usage.codecs, slot.first);
+    }
+  }
+
+  addVector(usage.attribute_definitions, attribute_defs_);
+
+  for (const auto & attr : attribute_defs_) {
+    addString(usage.attribute_definitions, attr->name_);
+    addString(usage.dbc_text, attr->dbc_text_);
+    addString(usage.dbc_text, attr->default_value_dbc_text_);
+
+    switch (attr->getAttrType()) {
+      case AttributeType::ENUM:
+      {
+        auto enum_ptr = dynamic_cast<const EnumAttribute *>(attr.get());
+        addAllocation(usage.attribute_definitions, sizeof(EnumAttribute));
+        addVector(usage.attribute_definitions, enum_ptr->enum_values_);
+
+        for (const auto & enum_val : enum_ptr->enum_values_) {
+          addString(usage.attribute_definitions, enum_val);
+        }
+
+        addString(usage.attribute_definitions, enum_ptr->default_value_);
+      } break;
+      case AttributeType::FLOAT:
+      {
+        auto float_ptr = dynamic_cast<const FloatAttribute *>(attr.get());
+        addAllocation(usage.attribute_definitions, sizeof(FloatAttribute));
+
+        if (float_ptr->default_value_) {
+          addAllocation(usage.attribute_definitions, sizeof(float));
+        }
+      } break;
+      case AttributeType::INT:
+      {
+        auto int_ptr = dynamic_cast<const IntAttribute *>(attr.get());
+        addAllocation(usage.attribute_definitions, sizeof(IntAttribute));
+
+        if (int_ptr->default_value_) {
+          addAllocation(usage.attribute_definitions, sizeof(int));
+        }
+      } break;
+      case AttributeType::STRING:
+      {
+        auto str_ptr = dynamic_cast<const StringAttribute *>(attr.get());
+        addAllocation(usage.attribute_definitions, sizeof(StringAttribute));
+        addString(usage.attribute_definitions, str_ptr->default_value_);
+      } break;
+    }
+  }
+
+  return usage;
+}
+
 void Database::generate(std::ostream & output) const
 {
   std::vector<BusNodeComment> bus_node_comments;
@@ -273,10 +952,56 @@ void Database::generate(std::ostream & output) const
     output << comment.dbc_text_;
   }
 
+  for (auto & msg : messages_) {
+    for (auto & sig : msg.second.signals_) {
+      if (!sig.second.multiplexer_name_.empty()) {
+        output << PREAMBLES[10] << " " << msg.second.id_ << " ";
+        output << sig.second.name_ << " " << sig.second.multiplexer_name_ << " ";
+
+        for (size_t i = 0; i < sig.second.multiplex_ranges_.size(); ++i) {
+          const auto & range = sig.second.multiplex_ranges_[i];
+          output << (i > 0 ? ", " : "") << range.first << "-" << range.second;
+        }
+
+        output << ";\n";
+      }
+    }
+  }
+
   // TODO(jwhitleyastuff): Write out attribute defs
   // TODO(jwhitleyastuff): Write out attribute default values
   // TODO(jwhitleyastuff): Write out attribute values
-  // TODO(jwhitleyastuff): Write out signal value lists
+
+  for (auto & msg : messages_) {
+    for (auto & sig : msg.second.signals_) {
+      if (sig.second.value_descs_.empty()) {
+        continue;
+      }
+
+      output << PREAMBLES[6] << " " << msg.second.id_ << " " << sig.second.name_;
+
+      for (auto & desc : sig.second.value_descs_) {
+        if (sig.second.is_signed_) {
+          output << " " << static_cast<int>(desc.first);
+        } else {
+          output << " " << desc.first;
+        }
+
+        output << " \"" << desc.second << "\"";
+      }
+
+      output << " ;\n";
+    }
+  }
+
+  for (auto & msg : messages_) {
+    for (auto & sig : msg.second.signals_) {
+      if (sig.second.value_type_ != SignalValueType::INTEGER) {
+        output << PREAMBLES[11] << " " << msg.second.id_ << " " << sig.second.name_ << " : ";
+        output << (sig.second.value_type_ == SignalValueType::FLOAT ? 1 : 2) << ";\n";
+      }
+    }
+  }
 }
 
 void Database::parse(std::istream & reader)
@@ -291,6 +1016,10 @@ void Database::parse(std::istream & reader)
   std::vector<SignalComment> signal_comments;
   std::unordered_map<std::string, std::pair<AttributeType, std::string>> attr_texts;
   std::unordered_map<std::string, std::string> attr_def_val_texts;
+  std::vector<ExtendedMux> ext_muxes;
+  std::vector<SignalValueList> value_lists;
+  std::vector<SignalValueTypeDef> value_types;
+  std::vector<AttributeValueDef> attr_values;
 
   while (std::getline(reader, line)) {
     // Ignore empty lines and lines starting with tab
@@ -351,23 +1080,42 @@ void Database::parse(std::istream & reader)
       } else if (preamble == PREAMBLES[6]) {  // SIGNAL VALUE LIST
         saveMsg(current_msg);
 
-        std::map<unsigned int, std::string> value_descs;
-
+        SignalValueList value_list;
         std::string temp_string;
-        std::string sig_name;
 
         // Message ID
         iss_line >> temp_string;
 
-        unsigned int id = std::stoul(temp_string);
+        // Value lists for environment variables have no message ID
+        if (temp_string.empty() ||
+          temp_string.find_first_not_of("0123456789") != std::string::npos)
+        {
+          continue;
+        }
+
+        value_list.msg_id = std::stoul(temp_string);
 
         // Signal Name
-        iss_line >> sig_name;
+        iss_line >> value_list.signal_name;
+
+        // Pairs of value and quoted description up to the ending semicolon
+        while (iss_line >> temp_string && temp_string != ";") {
+          std::string desc;
+          iss_line >> std::quoted(desc);
+
+          long long value;
 
-        // Get all remaining values up to the ending semicolon
-        std::getline(iss_line, temp_string, ';');
+          try {
+            value = std::stoll(temp_string);
+          } catch (const std::logic_error &) {
+            throw DbcParseException();
+          }
 
-        // TODO(jwhitleyastuff): Finish parsing values
+          // Negative values are stored as their 32-bit two's complement
+          value_list.value_descs[static_cast<unsigned int>(value)] = std::move(desc);
+        }
+
+        value_lists.push_back(std::move(value_list));
       } else if (preamble == PREAMBLES[7]) {  // ATTRIBUTE DEFINITION
         saveMsg(current_msg);
 
@@ -408,6 +1156,109 @@ void Database::parse(std::istream & reader)
         attr_def_val_texts[attr_name] = std::move(line);
       } else if (preamble == PREAMBLES[9]) {  // ATTRIBUTE VALUE
         saveMsg(current_msg);
+
+        // Applied once all objects have been parsed
+        AttributeValueDef attr_value;
+        std::string obj_type;
+
+        // Name is quoted
+        std::getline(iss_line, obj_type, '"');
+        std::getline(iss_line, attr_value.attr_name, '"');
+        iss_line >> obj_type;
+
+        if (obj_type == "BU_") {
+          attr_value.obj_type = DbcObjType::BUS_NODES;
+          iss_line >> attr_value.node_name;
+        } else if (obj_type == PREAMBLES[3]) {
+          attr_value.obj_type = DbcObjType::MESSAGE;
+          iss_line >> attr_value.msg_id;
+        } else if (obj_type == PREAMBLES[4]) {
+          attr_value.obj_type = DbcObjType::SIGNAL;
+          iss_line >> attr_value.msg_id;
+          iss_line >> attr_value.signal_name;
+        } else {
+          // Network and environment variable attributes have nothing to attach to
+          continue;
+        }
+
+        std::getline(iss_line, attr_value.value, ';');
+
+        auto first = attr_value.value.find_first_not_of(" \t\"");
+        auto last = attr_value.value.find_last_not_of(" \t\"");
+
+        if (first == std::string::npos) {
+          attr_value.value.clear();
+        } else {
+          attr_value.value = attr_value.value.substr(first, last - first + 1);
+        }
+
+        attr_values.push_back(std::move(attr_value));
+      } else if (preamble == PREAMBLES[10]) {  // EXTENDED MULTIPLEXING
+        saveMsg(current_msg);
+
+        // Applied once all signals have been parsed
+        ExtendedMux ext_mux;
+        std::string ranges_text;
+        std::string range_text;
+
+        iss_line >> ext_mux.msg_id;
+        iss_line >> ext_mux.signal_name;
+        iss_line >> ext_mux.switch_name;
+        std::getline(iss_line, ranges_text, ';');
+
+        std::istringstream ranges_stream(ranges_text);
+
+        // Ranges are "first-last" separated by commas
+        while (std::getline(ranges_stream, range_text, ',')) {
+          auto dash = range_text.find("-");
+
+          if (dash == std::string::npos) {
+            throw DbcParseException();
+          }
+
+          ext_mux.ranges.emplace_back(
+            static_cast<unsigned int>(std::stoul(range_text.substr(0, dash))),
+            static_cast<unsigned int>(std::stoul(range_text.substr(dash + 1))));
+        }
+
+        ext_muxes.push_back(std::move(ext_mux));
+      } else if (preamble == PREAMBLES[11]) {  // SIGNAL VALUE TYPE
+        saveMsg(current_msg);
+
+        SignalValueTypeDef value_type;
+        std::string temp_string;
+
+        iss_line >> value_type.msg_id;
+
+        // "<signal> : <type>;" where the separators may touch the names
+        std::getline(iss_line, temp_string);
+        std::replace(temp_string.begin(), temp_string.end(), ':', ' ');
+        std::replace(temp_string.begin(), temp_string.end(), ';', ' ');
+
+        std::istringstream fields(temp_string);
+        fields >> value_type.signal_name;
+        temp_string.clear();
+        fields >> temp_string;
+
+        if (temp_string.empty()) {
+          throw DbcParseException();
+        }
+
+        switch (temp_string[0]) {
+          case '0':
+            value_type.value_type = SignalValueType::INTEGER;
+            break;
+          case '1':
+            value_type.value_type = SignalValueType::FLOAT;
+            break;
+          case '2':
+            value_type.value_type = SignalValueType::DOUBLE;
+            break;
+          default:
+            throw DbcParseException();
+        }
+
+        value_types.push_back(std::move(value_type));
       }
     }
   }
@@ -446,6 +1297,22 @@ void Database::parse(std::istream & reader)
     }
   }
 
+  // Add extended multiplexing
+  for (auto & ext_mux : ext_muxes) {
+    auto msg_itr = messages_.find(ext_mux.msg_id);
+
+    if (msg_itr != messages_.end()) {
+      auto signal_itr = msg_itr->second.signals_.find(ext_mux.signal_name);
+
+      if (signal_itr != msg_itr->second.signals_.end()) {
+        auto & sig = signal_itr->second;
+        sig.multiplexer_name_ = std::move(ext_mux.switch_name);
+        sig.multiplex_ranges_.insert(
+          sig.multiplex_ranges_.end(), ext_mux.ranges.begin(), ext_mux.ranges.end());
+      }
+    }
+  }
+
   // Add attribute definitions
   for (auto & attr : attr_texts) {
     auto found_def_val = attr_def_val_texts.find(attr.first);
@@ -485,9 +1352,81 @@ void Database::parse(std::istream & reader)
     }
   }
 
-  // TODO(jwhitleyastuff): Apply attributes to DB objects
+  // Add attribute values
+  for (auto & attr_value : attr_values) {
+    if (attr_value.obj_type == DbcObjType::BUS_NODES) {
+      for (auto & bus_node : bus_nodes_) {
+        if (bus_node.name_ == attr_value.node_name) {
+          bus_node.attribute_values_[attr_value.attr_name] = attr_value.value;
+        }
+      }
+
+      continue;
+    }
+
+    auto msg_itr = messages_.find(attr_value.msg_id);
+
+    if (msg_itr == messages_.end()) {
+      continue;
+    }
+
+    if (attr_value.obj_type == DbcObjType::MESSAGE) {
+      msg_itr->second.attribute_values_[attr_value.attr_name] = std::move(attr_value.value);
+    } else {
+      auto signal_itr = msg_itr->second.signals_.find(attr_value.signal_name);
+
+      if (signal_itr != msg_itr->second.signals_.end()) {
+        signal_itr->second.attribute_values_[attr_value.attr_name] = std::move(attr_value.value);
+      }
+    }
+  }
+
+  // Add signal value description lists
+  for (auto & value_list : value_lists) {
+    auto msg_itr = messages_.find(value_list.msg_id);
 
-  // TODO(jwhitleyastuff): Add signal value description lists to signals
+    if (msg_itr != messages_.end()) {
+      auto signal_itr = msg_itr->second.signals_.find(value_list.signal_name);
+
+      if (signal_itr != msg_itr->second.signals_.end()) {
+        signal_itr->second.value_descs_ = std::move(value_list.value_descs);
+      }
+    }
+  }
+
+  // Add signal value types. Lengths which don't match the type
+  // can't be reinterpreted, so those signals stay integers.
+  for (auto & value_type : value_types) {
+    auto msg_itr = messages_.find(value_type.msg_id);
+
+    if (msg_itr != messages_.end()) {
+      auto signal_itr = msg_itr->second.signals_.find(value_type.signal_name);
+
+      if (signal_itr != msg_itr->second.signals_.end()) {
+        auto & sig = signal_itr->second;
+
+        if ((value_type.value_type == SignalValueType::FLOAT && sig.length_ == 32) ||
+          (value_type.value_type == SignalValueType::DOUBLE && sig.length_ == 64))
+        {
+          sig.value_type_ = value_type.value_type;
+        } else {
+          sig.value_type_ = SignalValueType::INTEGER;
+        }
+      }
+    }
+  }
+
+  // Layouts, start values and E2E configs depend on the signals, value
+  // types and attribute values added above, so they're built last
+  for (auto & msg : messages_) {
+    msg.second.layout_ = layout_pool_.intern(msg.second.buildLayout());
+    msg.second.updateHashes();
+    msg.second.buildTemplate(attribute_defs_);
+    msg.second.loadE2EConfig(attribute_defs_);
+  }
+
+  buildCodecs();
+  buildLookupTables(LookupTableConfig());
 }
 
 void Database::saveMsg(std::unique_ptr<Message> & msg_ptr)
@@ -498,8 +1437,10 @@ void Database::saveMsg(std::unique_ptr<Message> & msg_ptr)
     // Some diagnostic messages are created by Vector tools
     // with CAN IDs > 29 bits. Don't add them.
     if (id <= MAX_CAN_ID) {
-      messages_.emplace(id, std::move(*(msg_ptr.release())));
+      messages_.emplace(id, std::move(*msg_ptr));
     }
+
+    msg_ptr.reset();
   }
 }
 
@@ -0,0 +1,403 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "database_diff.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+namespace
+{
+
+size_t hashAttributeDefinition(const Attribute & attr)
+{
+  std::hash<std::string> str_hash;
+  size_t seed = str_hash(attr.getName());
+
+  hashCombine(seed, static_cast<size_t>(attr.getAttrType()));
+  hashCombine(seed, static_cast<size_t>(attr.getDbcObjType()));
+  hashCombine(seed, str_hash(attr.getDbcText()));
+  hashCombine(seed, str_hash(attr.getDefaultValueDbcText()));
+
+  return seed;
+}
+
+bool hasCommentOrAttrs(const Signal & sig)
+{
+  return sig.getComment() != nullptr || sig.hasAttributeValues();
+}
+
+template<typename Change>
+void compareComments(
+  std::vector<Change> & changes,
+  const std::string * from,
+  const std::string * to,
+  Change change)
+{
+  if (from == nullptr && to == nullptr) {
+    return;
+  } else if (from == nullptr) {
+    change.type = ChangeType::ADDED;
+  } else if (to == nullptr) {
+    change.type = ChangeType::REMOVED;
+  } else if (*from != *to) {
+    change.type = ChangeType::MODIFIED;
+  } else {
+    return;
+  }
+
+  changes.push_back(std::move(change));
+}
+
+void compareAttrValues(
+  std::vector<AttributeChange> & changes,
+  const std::unordered_map<std::string, std::string> & from,
+  const std::unordered_map<std::string, std::string> & to,
+  DbcObjType obj_type,
+  unsigned int msg_id,
+  const std::string & obj_name)
+{
+  if (from.empty() && to.empty()) {
+    return;
+  }
+
+  for (const auto & to_val : to) {
+    auto from_itr = from.find(to_val.first);
+
+    if (from_itr == from.end()) {
+      changes.push_back({obj_type, msg_id, obj_name, to_val.first, ChangeType::ADDED});
+    } else if (from_itr->second != to_val.second) {
+      changes.push_back({obj_type, msg_id, obj_name, to_val.first, ChangeType::MODIFIED});
+    }
+  }
+
+  for (const auto & from_val : from) {
+    if (to.find(from_val.first) == to.end()) {
+      changes.push_back({obj_type, msg_id, obj_name, from_val.first, ChangeType::REMOVED});
+    }
+  }
+}
+
+// Stands in for the missing side of an added or removed message, so
+// that all of its signals, comments and attribute values are reported
+Message emptyMessage(unsigned int id)
+{
+  return Message(id, std::string(), 0, BusNode(""), std::vector<Signal>());
+}
+
+}  // namespace
+
+DatabaseDiff::DatabaseDiff(const Database & from, const Database & to)
+{
+  compare(from, to);
+}
+
+DatabaseDiff::DatabaseDiff(const DatabaseSnapshot & from, const DatabaseSnapshot & to)
+{
+  compare(from, to);
+}
+
+const std::vector<BusNodeChange> & DatabaseDiff::getBusNodeChanges() const
+{
+  return bus_node_changes_;
+}
+
+const std::vector<MessageChange> & DatabaseDiff::getMessageChanges() const
+{
+  return message_changes_;
+}
+
+const std::vector<SignalChange> & DatabaseDiff::getSignalChanges() const
+{
+  return signal_changes_;
+}
+
+const std::vector<CommentChange> & DatabaseDiff::getCommentChanges() const
+{
+  return comment_changes_;
+}
+
+const std::vector<AttributeChange> & DatabaseDiff::getAttributeChanges() const
+{
+  return attribute_changes_;
+}
+
+bool DatabaseDiff::empty() const
+{
+  return bus_node_changes_.empty() &&
+         message_changes_.empty() &&
+         signal_changes_.empty() &&
+         comment_changes_.empty() &&
+         attribute_changes_.empty();
+}
+
+template<typename DB>
+void DatabaseDiff::compare(const DB & from, const DB & to)
+{
+  auto from_msgs = from.getMessages();
+  auto to_msgs = to.getMessages();
+
+  for (const auto & to_msg : to_msgs) {
+    auto from_itr = from_msgs.find(to_msg.first);
+
+    if (from_itr == from_msgs.end()) {
+      message_changes_.push_back({to_msg.first, ChangeType::ADDED});
+      compareMessages(emptyMessage(to_msg.first), *(to_msg.second));
+    } else if (from_itr->second != to_msg.second) {
+      // Snapshots share untouched messages so identical pointers
+      // can be skipped without looking inside
+      if (compareMessages(*(from_itr->second), *(to_msg.second))) {
+        message_changes_.push_back({to_msg.first, ChangeType::MODIFIED});
+      }
+    }
+  }
+
+  for (const auto & from_msg : from_msgs) {
+    if (to_msgs.find(from_msg.first) == to_msgs.end()) {
+      message_changes_.push_back({from_msg.first, ChangeType::REMOVED});
+      compareMessages(*(from_msg.second), emptyMessage(from_msg.first));
+    }
+  }
+
+  auto from_nodes = from.getBusNodes();
+  auto to_nodes = to.getBusNodes();
+  std::unordered_map<std::string, const BusNode *> from_nodes_by_name;
+  static const std::unordered_map<std::string, std::string> no_attr_values;
+
+  for (const auto & node : from_nodes) {
+    from_nodes_by_name[node->name_] = node;
+  }
+
+  for (const auto & to_node : to_nodes) {
+    auto from_itr = from_nodes_by_name.find(to_node->name_);
+    const BusNode * from_node = nullptr;
+
+    if (from_itr != from_nodes_by_name.end()) {
+      from_node = from_itr->second;
+      from_nodes_by_name.erase(from_itr);
+    } else {
+      bus_node_changes_.push_back({to_node->name_, ChangeType::ADDED});
+    }
+
+    compareComments(
+      comment_changes_,
+      from_node ? from_node->comment_.get() : nullptr,
+      to_node->comment_.get(),
+      CommentChange{DbcObjType::BUS_NODES, 0, to_node->name_, ChangeType::MODIFIED});
+    compareAttrValues(
+      attribute_changes_,
+      from_node ? from_node->attribute_values_ : no_attr_values,
+      to_node->attribute_values_,
+      DbcObjType::BUS_NODES, 0, to_node->name_);
+  }
+
+  // Anything left was removed
+  for (const auto & from_node : from_nodes_by_name) {
+    bus_node_changes_.push_back({from_node.first, ChangeType::REMOVED});
+    compareComments(
+      comment_changes_,
+      from_node.second->comment_.get(),
+      nullptr,
+      CommentChange{DbcObjType::BUS_NODES, 0, from_node.first, ChangeType::MODIFIED});
+    compareAttrValues(
+      attribute_changes_,
+      from_node.second->attribute_values_,
+      no_attr_values,
+      DbcObjType::BUS_NODES, 0, from_node.first);
+  }
+
+  std::unordered_map<std::string, const Attribute *> from_attr_defs;
+
+  for (const auto & attr : from.getAttributeDefinitions()) {
+    from_attr_defs[attr->getName()] = attr;
+  }
+
+  for (const auto & to_attr : to.getAttributeDefinitions()) {
+    auto from_itr = from_attr_defs.find(to_attr->getName());
+
+    if (from_itr == from_attr_defs.end()) {
+      attribute_changes_.push_back(
+        {DbcObjType::ATTRIBUTE_DEF, 0, "", to_attr->getName(), ChangeType::ADDED});
+    } else {
+      if (hashAttributeDefinition(*(from_itr->second)) != hashAttributeDefinition(*to_attr)) {
+        attribute_changes_.push_back(
+          {DbcObjType::ATTRIBUTE_DEF, 0, "", to_attr->getName(), ChangeType::MODIFIED});
+      }
+
+      from_attr_defs.erase(from_itr);
+    }
+  }
+
+  for (const auto & from_attr : from_attr_defs) {
+    attribute_changes_.push_back(
+      {DbcObjType::ATTRIBUTE_DEF, 0, "", from_attr.first, ChangeType::REMOVED});
+  }
+
+  sortChanges();
+}
+
+bool DatabaseDiff::compareMessages(const Message & from, const Message & to)
+{
+  static const std::unordered_map<std::string, std::string> no_attr_values;
+  unsigned int id = to.id_;
+
+  // The content hash covers the message header and every signal
+  // definition, so only comments and attribute values can differ
+  // between messages whose hashes match.
+  bool same_definition = (from.content_hash_ == to.content_hash_);
+  bool modified = false;
+
+  if (same_definition && from.annotation_hash_ == to.annotation_hash_) {
+    return false;
+  }
+
+  for (const auto & to_sig : to.signals_) {
+    if (same_definition && !hasCommentOrAttrs(to_sig.second)) {
+      continue;
+    }
+
+    auto from_itr = from.signals_.find(to_sig.first);
+    const Signal * from_sig = nullptr;
+
+    if (from_itr != from.signals_.end()) {
+      from_sig = &(from_itr->second);
+    }
+
+    if (!same_definition) {
+      if (from_sig == nullptr) {
+        signal_changes_.push_back({id, to_sig.first, ChangeType::ADDED});
+        modified = true;
+      } else if (from_sig->getContentHash() != to_sig.second.getContentHash()) {
+        signal_changes_.push_back({id, to_sig.first, ChangeType::MODIFIED});
+        modified = true;
+      }
+    }
+
+    compareComments(
+      comment_changes_,
+      from_sig ? from_sig->comment_.get() : nullptr,
+      to_sig.second.comment_.get(),
+      CommentChange{DbcObjType::SIGNAL, id, to_sig.first, ChangeType::MODIFIED});
+    compareAttrValues(
+      attribute_changes_,
+      from_sig ? from_sig->attribute_values_ : no_attr_values,
+      to_sig.second.attribute_values_,
+      DbcObjType::SIGNAL, id, to_sig.first);
+  }
+
+  for (const auto & from_sig : from.signals_) {
+    if (same_definition && !hasCommentOrAttrs(from_sig.second)) {
+      continue;
+    }
+
+    auto to_itr = to.signals_.find(from_sig.first);
+
+    if (to_itr == to.signals_.end()) {
+      signal_changes_.push_back({id, from_sig.first, ChangeType::REMOVED});
+      modified = true;
+    } else if (!same_definition || hasCommentOrAttrs(to_itr->second)) {
+      // Already compared above
+      continue;
+    }
+
+    compareComments(
+      comment_changes_,
+      from_sig.second.comment_.get(),
+      to_itr != to.signals_.end() ? to_itr->second.comment_.get() : nullptr,
+      CommentChange{DbcObjType::SIGNAL, id, from_sig.first, ChangeType::MODIFIED});
+    compareAttrValues(
+      attribute_changes_,
+      from_sig.second.attribute_values_,
+      to_itr != to.signals_.end() ? to_itr->second.attribute_values_ : no_attr_values,
+      DbcObjType::SIGNAL, id, from_sig.first);
+  }
+
+  if (!same_definition) {
+    modified = modified ||
+      from.name_ != to.name_ ||
+      from.dlc_ != to.dlc_ ||
+      from.transmitting_node_.name_ != to.transmitting_node_.name_;
+  }
+
+  compareComments(
+    comment_changes_,
+    from.comment_.get(),
+    to.comment_.get(),
+    CommentChange{DbcObjType::MESSAGE, id, "", ChangeType::MODIFIED});
+  compareAttrValues(
+    attribute_changes_,
+    from.attribute_values_,
+    to.attribute_values_,
+    DbcObjType::MESSAGE, id, "");
+
+  return modified;
+}
+
+void DatabaseDiff::sortChanges()
+{
+  std::sort(
+    bus_node_changes_.begin(), bus_node_changes_.end(),
+    [](const BusNodeChange & lhs, const BusNodeChange & rhs)
+    {
+      return lhs.node_name < rhs.node_name;
+    });
+  std::sort(
+    message_changes_.begin(), message_changes_.end(),
+    [](const MessageChange & lhs, const MessageChange & rhs)
+    {
+      return lhs.msg_id < rhs.msg_id;
+    });
+  std::sort(
+    signal_changes_.begin(), signal_changes_.end(),
+    [](const SignalChange & lhs, const SignalChange & rhs)
+    {
+      return std::tie(lhs.msg_id, lhs.signal_name) < std::tie(rhs.msg_id, rhs.signal_name);
+    });
+  std::sort(
+    comment_changes_.begin(), comment_changes_.end(),
+    [](const CommentChange & lhs, const CommentChange & rhs)
+    {
+      return std::tie(lhs.obj_type, lhs.msg_id, lhs.node_or_signal_name) <
+             std::tie(rhs.obj_type, rhs.msg_id, rhs.node_or_signal_name);
+    });
+  std::sort(
+    attribute_changes_.begin(), attribute_changes_.end(),
+    [](const AttributeChange & lhs, const AttributeChange & rhs)
+    {
+      return std::tie(lhs.obj_type, lhs.msg_id, lhs.node_or_signal_name, lhs.attr_name) <
+             std::tie(rhs.obj_type, rhs.msg_id, rhs.node_or_signal_name, rhs.attr_name);
+    });
+}
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
@@ -0,0 +1,483 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include "decode_subset.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+namespace
+{
+
+// The switch slot a condition depends on, or -1 where MuxTree
+// treats the slot as always present.
+int switchOf(const std::vector<MuxCondition> & conditions, size_t slot)
+{
+  int switch_slot = conditions[slot].switch_slot;
+
+  if (switch_slot < 0 ||
+    static_cast<size_t>(switch_slot) >= conditions.size() ||
+    static_cast<size_t>(switch_slot) == slot)
+  {
+    return -1;
+  }
+
+  return switch_slot;
+}
+
+// Number of switches above the slot, or -1 if its switches form a
+// cycle (MuxTree decodes those unconditionally).
+int muxDepth(const std::vector<MuxCondition> & conditions, size_t slot)
+{
+  int depth = 0;
+  int switch_slot = switchOf(conditions, slot);
+
+  while (switch_slot >= 0) {
+    if (++depth > static_cast<int>(conditions.size())) {
+      return -1;
+    }
+
+    switch_slot = switchOf(conditions, static_cast<size_t>(switch_slot));
+  }
+
+  return depth;
+}
+
+// Most negative exponent tried for fixed-point values
+constexpr int MIN_FIXED_EXPONENT = -9;
+
+// Exponent for FLOAT and DOUBLE signals, whose factor and offset
+// say nothing about the precision of the value
+constexpr int IEEE_FIXED_EXPONENT = -6;
+
+// 2^63, exactly representable
+constexpr double INT64_LIMIT = 9223372036854775808.0;
+
+// Rounds to the nearest integer, saturating at the int64_t range
+// and mapping NaN to zero
+int64_t saturatingRound(double value)
+{
+  value = std::round(value);
+
+  if (std::isnan(value)) {
+    return 0;
+  } else if (value >= INT64_LIMIT) {
+    return INT64_MAX;
+  } else if (value < -INT64_LIMIT) {
+    return INT64_MIN;
+  }
+
+  return static_cast<int64_t>(value);
+}
+
+// Factors and offsets are stored as floats, so a value counts as a
+// whole number when it is within float precision of one.
+bool nearlyWhole(double value, double & whole)
+{
+  whole = std::round(value);
+  return std::fabs(value - whole) <= 1e-7 * std::max(std::fabs(value), 1.0);
+}
+
+int fixedPointExponent(double factor, double offset)
+{
+  double scale = 1.0;
+
+  for (int exponent = 0; exponent > MIN_FIXED_EXPONENT; --exponent) {
+    double whole_factor = 0.0;
+    double whole_offset = 0.0;
+
+    // A tiny factor is within float precision of zero, but isn't zero
+    if (nearlyWhole(factor * scale, whole_factor) &&
+      nearlyWhole(offset * scale, whole_offset) &&
+      (whole_factor != 0.0 || factor == 0.0))
+    {
+      return exponent;
+    }
+
+    scale *= 10.0;
+  }
+
+  return MIN_FIXED_EXPONENT;
+}
+
+// Whether a scaled factor and offset can be used for integer-only
+// decoding: both must fit in an int64_t, and a non-zero factor must
+// not round away to nothing.
+bool fixedPointRepresentable(double factor, double offset, double scale)
+{
+  const double fixed_factor = std::round(factor * scale);
+  const double fixed_offset = std::round(offset * scale);
+
+  return std::fabs(fixed_factor) < INT64_LIMIT &&
+         std::fabs(fixed_offset) < INT64_LIMIT &&
+         (fixed_factor != 0.0 || factor == 0.0);
+}
+
+}  // namespace
+
+// Begin DecodeSubset
+
+DecodeSubset::DecodeSubset(
+  const MessageCodec & codec,
+  const std::vector<SignalHandle> & signals,
+  DecodeMode mode)
+  : codec_(&codec)
+{
+  std::vector<std::pair<SignalHandle, DecodeMode>> signal_modes;
+  signal_modes.reserve(signals.size());
+
+  for (const auto & handle : signals) {
+    signal_modes.emplace_back(handle, mode);
+  }
+
+  compile(codec, signal_modes);
+}
+
+DecodeSubset::DecodeSubset(
+  const MessageCodec & codec,
+  const std::vector<std::pair<SignalHandle, DecodeMode>> & signals)
+  : codec_(&codec)
+{
+  compile(codec, signals);
+}
+
+void DecodeSubset::compile(
+  const MessageCodec & codec,
+  const std::vector<std::pair<SignalHandle, DecodeMode>> & signals)
+{
+  const SignalLayout * layout = codec.getLayout();
+  const auto & plans = layout->getPlans();
+  const auto & conditions = layout->getMuxConditions();
+  const size_t count = plans.size();
+
+  // Switches pulled in for multiplexing only need raw values
+  std::vector<bool> physical(count, false);
+  std::vector<bool> fixed_point(count, false);
+
+  contained_.assign(count, false);
+  fixed_exponents_.resize(count);
+
+  for (const auto & signal : signals) {
+    const uint32_t slot = signal.first.slot;
+
+    // Codecs outside a Database don't know their index, so only the
+    // slot can be checked for them
+    if (slot >= count ||
+      (codec.message_index_ != SignalHandle::INVALID &&
+      signal.first.message_index != codec.message_index_))
+    {
+      throw DbcSubscriptionException();
+    }
+
+    contained_[slot] = true;
+    physical[slot] = physical[slot] || signal.second == DecodeMode::PHYSICAL;
+    fixed_point[slot] = fixed_point[slot] || signal.second == DecodeMode::FIXED_POINT;
+  }
+
+  const auto & layout_entries = layout->getEntries();
+
+  for (size_t slot = 0; slot < count; ++slot) {
+    fixed_exponents_[slot] = (layout_entries[slot].value_type != SignalValueType::INTEGER ?
+      IEEE_FIXED_EXPONENT :
+      fixedPointExponent(codec.factors_[slot], codec.offsets_[slot]));
+  }
+
+  std::vector<int> depths(count, 0);
+
+  if (!conditions.empty()) {
+    for (size_t slot = 0; slot < count; ++slot) {
+      depths[slot] = muxDepth(conditions, slot);
+    }
+
+    // A signal is only present when its switches are, so decoding
+    // it needs them too
+    for (size_t slot = 0; slot < count; ++slot) {
+      if (!contained_[slot] || depths[slot] < 0) {
+        continue;
+      }
+
+      for (int switch_slot = switchOf(conditions, slot);
+        switch_slot >= 0;
+        switch_slot = switchOf(conditions, static_cast<size_t>(switch_slot)))
+      {
+        contained_[switch_slot] = true;
+      }
+    }
+  }
+
+  for (size_t slot = 0; slot < count; ++slot) {
+    if (contained_[slot]) {
+      slots_.push_back(static_cast<uint32_t>(slot));
+    }
+  }
+
+  // Switches before the slots they select, otherwise in slot order
+  std::stable_sort(
+    slots_.begin(), slots_.end(),
+    [&depths](uint32_t lhs, uint32_t rhs)
+    {
+      return std::max(depths[lhs], 0) < std::max(depths[rhs], 0);
+    });
+
+  std::vector<int32_t> entry_indices(count, -1);
+
+  for (auto slot : slots_) {
+    const double scale = std::pow(10.0, -fixed_exponents_[slot]);
+
+    if (fixed_point[slot] &&
+      layout_entries[slot].value_type == SignalValueType::INTEGER &&
+      !fixedPointRepresentable(codec.factors_[slot], codec.offsets_[slot], scale))
+    {
+      throw DbcSubscriptionException();
+    }
+
+    Entry entry{
+      plans[slot], slot, -1, physical[slot], fixed_point[slot],
+      layout_entries[slot].value_type, codec.factors_[slot], codec.offsets_[slot],
+      saturatingRound(codec.factors_[slot] * scale),
+      saturatingRound(codec.offsets_[slot] * scale),
+      scale};
+
+    if (!conditions.empty() && depths[slot] > 0) {
+      entry.switch_entry = entry_indices[switchOf(conditions, slot)];
+    }
+
+    entry_indices[slot] = static_cast<int32_t>(entries_.size());
+    entries_.push_back(entry);
+    ranges_.push_back(
+      entry.switch_entry >= 0 ?
+      conditions[slot].ranges :
+      std::vector<std::pair<unsigned int, unsigned int>>());
+  }
+}
+
+const MessageCodec * DecodeSubset::getCodec() const
+{
+  return codec_;
+}
+
+const std::vector<uint32_t> & DecodeSubset::getSlots() const
+{
+  return slots_;
+}
+
+bool DecodeSubset::contains(const SignalHandle & handle) const
+{
+  return handle.slot < contained_.size() && contained_[handle.slot] &&
+         (codec_->message_index_ == SignalHandle::INVALID ||
+         handle.message_index == codec_->message_index_);
+}
+
+int DecodeSubset::getFixedPointExponent(const SignalHandle & handle) const
+{
+  return fixed_exponents_.at(handle.slot);
+}
+
+TranscodeErrorType DecodeSubset::decode(
+  const uint8_t * frame,
+  size_t frame_length,
+  MessageCodec::Output & output) const
+{
+  const size_t length = codec_->getLength();
+
+  if (frame_length < length) {
+    return TranscodeErrorType::INVALID_LENGTH;
+  }
+
+  // No-ops once the Output has been used with this message
+  const size_t count = contained_.size();
+  output.raw_values.resize(count);
+  output.values.resize(count);
+  output.active.resize(count);
+  output.fixed_values.resize(count);
+
+  PaddedFrame padded_frame;
+  padded_frame.fill(0);
+  std::memcpy(padded_frame.data() + FRAME_PADDING, frame, length);
+
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    const Entry & entry = entries_[i];
+
+    if (entry.switch_entry >= 0) {
+      const uint32_t switch_slot = entries_[entry.switch_entry].slot;
+      bool selected = false;
+
+      if (output.active[switch_slot] != 0) {
+        const uint64_t switch_value = static_cast<uint64_t>(output.raw_values[switch_slot]);
+
+        for (const auto & range : ranges_[i]) {
+          if (range.first <= switch_value && switch_value <= range.second) {
+            selected = true;
+            break;
+          }
+        }
+      }
+
+      if (!selected) {
+        output.raw_values[entry.slot] = 0;
+        output.active[entry.slot] = 0;
+
+        if (entry.physical) {
+          output.values[entry.slot] = 0.0;
+        }
+
+        if (entry.fixed_point) {
+          output.fixed_values[entry.slot] = 0;
+        }
+
+        continue;
+      }
+    }
+
+    uint64_t raw = entry.plan.extract(padded_frame.data());
+
+    output.raw_values[entry.slot] = static_cast<int64_t>(raw);
+    output.active[entry.slot] = 1;
+
+    if (entry.value_type != SignalValueType::INTEGER) {
+      if (entry.physical || entry.fixed_point) {
+        const double value = ieeePhysical(entry.value_type, raw, entry.factor, entry.offset);
+
+        if (entry.physical) {
+          output.values[entry.slot] = value;
+        }
+
+        if (entry.fixed_point) {
+          output.fixed_values[entry.slot] = saturatingRound(value * entry.fixed_scale);
+        }
+      }
+
+      continue;
+    }
+
+    if (entry.physical) {
+      double raw_double = (entry.plan.sign_bit != 0 ?
+        static_cast<double>(static_cast<int64_t>(raw)) :
+        static_cast<double>(raw));
+
+      output.values[entry.slot] = raw_double * entry.factor + entry.offset;
+    }
+
+    if (entry.fixed_point) {
+      // Unsigned so that out of range results wrap instead of being undefined.
+      // Sign-extended raw values give the right two's complement result.
+      output.fixed_values[entry.slot] = static_cast<int64_t>(
+        raw * static_cast<uint64_t>(entry.fixed_factor) +
+        static_cast<uint64_t>(entry.fixed_offset));
+    }
+  }
+
+  return TranscodeErrorType::NONE;
+}
+
+// End DecodeSubset
+// Begin SubscriptionGroup
+
+SubscriptionGroup::SubscriptionGroup(const MessageCodec & codec)
+  : codec_(&codec),
+    next_id_(0),
+    subset_(codec, std::vector<SignalHandle>())
+{
+}
+
+size_t SubscriptionGroup::subscribe(
+  const std::vector<SignalHandle> & signals,
+  DecodeMode mode)
+{
+  std::vector<std::pair<SignalHandle, DecodeMode>> signal_modes;
+
+  for (const auto & handle : signals) {
+    signal_modes.emplace_back(handle, mode);
+  }
+
+  auto all_signals = collectSignals(next_id_);
+  all_signals.insert(all_signals.end(), signal_modes.begin(), signal_modes.end());
+
+  // Compiled before anything is stored so that nothing changes if a
+  // handle or signal is rejected
+  DecodeSubset subset(*codec_, all_signals);
+
+  size_t subscription_id = next_id_;
+  subscriptions_.emplace(subscription_id, std::move(signal_modes));
+  ++next_id_;
+  subset_ = std::move(subset);
+
+  return subscription_id;
+}
+
+void SubscriptionGroup::unsubscribe(size_t subscription_id)
+{
+  if (subscriptions_.count(subscription_id) > 0) {
+    DecodeSubset subset(*codec_, collectSignals(subscription_id));
+    subscriptions_.erase(subscription_id);
+    subset_ = std::move(subset);
+  }
+}
+
+size_t SubscriptionGroup::getSubscriptionCount() const
+{
+  return subscriptions_.size();
+}
+
+const DecodeSubset & SubscriptionGroup::getSubset() const
+{
+  return subset_;
+}
+
+TranscodeErrorType SubscriptionGroup::decode(
+  const uint8_t * frame,
+  size_t frame_length,
+  MessageCodec::Output & output) const
+{
+  return subset_.decode(frame, frame_length, output);
+}
+
+std::vector<std::pair<SignalHandle, DecodeMode>> SubscriptionGroup::collectSignals(
+  size_t skipped_id) const
+{
+  std::vector<std::pair<SignalHandle, DecodeMode>> all_signals;
+
+  for (const auto & subscription : subscriptions_) {
+    if (subscription.first != skipped_id) {
+      all_signals.insert(
+        all_signals.end(), subscription.second.begin(), subscription.second.end());
+    }
+  }
+
+  return all_signals;
+}
+
+// End SubscriptionGroup
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
@@ -0,0 +1,300 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "e2e.hpp"
+#include "message.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+namespace
+{
+
+constexpr size_t SLICE_BYTES = 8;
+
+int findSlot(const std::vector<const Signal *> & layout_signals, const std::string & name)
+{
+  for (size_t slot = 0; slot < layout_signals.size(); ++slot) {
+    if (layout_signals[slot]->getName() == name) {
+      return static_cast<int>(slot);
+    }
+  }
+
+  return -1;
+}
+
+// Counter and checksum have to be in every frame
+bool isAlwaysPresent(const SignalLayout & layout, int slot)
+{
+  const auto & conditions = layout.getMuxConditions();
+
+  if (conditions.empty()) {
+    return true;
+  }
+
+  if (conditions[slot].switch_slot >= 0) {
+    return false;
+  }
+
+  for (const auto & condition : conditions) {
+    if (condition.switch_slot == slot) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace
+
+// Begin Crc8
+
+Crc8::Crc8(uint8_t polynomial, uint8_t init, uint8_t xor_out)
+  : init_(init),
+    xor_out_(xor_out)
+{
+  for (unsigned int value = 0; value < 256; ++value) {
+    uint8_t crc = static_cast<uint8_t>(value);
+
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = static_cast<uint8_t>((crc & 0x80) != 0 ? (crc << 1) ^ polynomial : crc << 1);
+    }
+
+    tables_[0][value] = crc;
+  }
+
+  // Each further zero byte is one more pass through the first table
+  for (size_t k = 1; k < SLICE_BYTES; ++k) {
+    for (unsigned int value = 0; value < 256; ++value) {
+      tables_[k][value] = tables_[0][tables_[k - 1][value]];
+    }
+  }
+}
+
+const Crc8 * Crc8::get(ChecksumType type)
+{
+  static const Crc8 sae_j1850(0x1D, 0xFF, 0xFF);
+  static const Crc8 h2f(0x2F, 0xFF, 0xFF);
+
+  switch (type) {
+    case ChecksumType::CRC8_SAE_J1850:
+      return &sae_j1850;
+    case ChecksumType::CRC8_H2F:
+      return &h2f;
+    default:
+      return nullptr;
+  }
+}
+
+uint8_t Crc8::getInit() const
+{
+  return init_;
+}
+
+uint8_t Crc8::update(uint8_t crc, const uint8_t * data, size_t length) const
+{
+  // The CRC register is a single byte, so it only folds into the
+  // first byte of each slice
+  while (length >= SLICE_BYTES) {
+    crc =
+      tables_[7][crc ^ data[0]] ^ tables_[6][data[1]] ^
+      tables_[5][data[2]] ^ tables_[4][data[3]] ^
+      tables_[3][data[4]] ^ tables_[2][data[5]] ^
+      tables_[1][data[6]] ^ tables_[0][data[7]];
+    data += SLICE_BYTES;
+    length -= SLICE_BYTES;
+  }
+
+  return updateBytewise(crc, data, length);
+}
+
+uint8_t Crc8::updateBytewise(uint8_t crc, const uint8_t * data, size_t length) const
+{
+  for (size_t i = 0; i < length; ++i) {
+    crc = tables_[0][crc ^ data[i]];
+  }
+
+  return crc;
+}
+
+uint8_t Crc8::finish(uint8_t crc) const
+{
+  return crc ^ xor_out_;
+}
+
+uint8_t Crc8::compute(const uint8_t * data, size_t length) const
+{
+  return finish(update(init_, data, length));
+}
+
+// End Crc8
+// Begin E2EProfile
+
+E2EProfile::E2EProfile()
+  : crc_(nullptr),
+    counter_slot_(-1),
+    checksum_slot_(-1),
+    counter_max_(0),
+    max_counter_delta_(0),
+    checksum_byte_(0),
+    length_(0),
+    data_id_crc_(0)
+{
+}
+
+E2EProfile::E2EProfile(const Message & msg)
+  : E2EProfile()
+{
+  const E2EConfig & config = msg.getE2EConfig();
+
+  if (!config.isEnabled()) {
+    return;
+  }
+
+  const SignalLayout & layout = *(msg.getLayout());
+  const std::vector<const Signal *> layout_signals = msg.getLayoutSignals();
+  length_ = msg.getLength();
+
+  if (!config.counter_signal.empty()) {
+    counter_slot_ = findSlot(layout_signals, config.counter_signal);
+
+    if (counter_slot_ < 0 || !isAlwaysPresent(layout, counter_slot_) ||
+      layout_signals[counter_slot_]->getValueType() != SignalValueType::INTEGER ||
+      config.max_counter_delta == 0)
+    {
+      throw DbcE2EConfigException();
+    }
+
+    const uint64_t full_range = layout.getPlans()[counter_slot_].mask;
+
+    if (config.counter_max > full_range) {
+      throw DbcE2EConfigException();
+    }
+
+    counter_max_ = (config.counter_max > 0 ? config.counter_max : full_range);
+    max_counter_delta_ = config.max_counter_delta;
+  }
+
+  if (config.checksum_type != ChecksumType::NONE || !config.checksum_signal.empty()) {
+    crc_ = Crc8::get(config.checksum_type);
+    checksum_slot_ = findSlot(layout_signals, config.checksum_signal);
+
+    if (crc_ == nullptr || checksum_slot_ < 0 || !isAlwaysPresent(layout, checksum_slot_)) {
+      throw DbcE2EConfigException();
+    }
+
+    const Signal & sig = *(layout_signals[checksum_slot_]);
+    const unsigned int start_bit = sig.getStartBit();
+    // Intel signals start at their LSB and Motorola signals at their MSB
+    const unsigned int first_bit = (sig.getEndianness() == Order::LE ? 0 : 7);
+
+    if (sig.getLength() != 8 || sig.isSigned() ||
+      sig.getValueType() != SignalValueType::INTEGER ||
+      start_bit % 8 != first_bit || start_bit / 8 >= length_)
+    {
+      throw DbcE2EConfigException();
+    }
+
+    checksum_byte_ = start_bit / 8;
+
+    const uint8_t data_id[2] = {
+      static_cast<uint8_t>(config.data_id & 0xFF),
+      static_cast<uint8_t>(config.data_id >> 8)
+    };
+
+    data_id_crc_ = crc_->update(crc_->getInit(), data_id, 2);
+  }
+}
+
+bool E2EProfile::isEnabled() const
+{
+  return counter_slot_ >= 0 || checksum_slot_ >= 0;
+}
+
+int E2EProfile::getCounterSlot() const
+{
+  return counter_slot_;
+}
+
+int E2EProfile::getChecksumSlot() const
+{
+  return checksum_slot_;
+}
+
+uint64_t E2EProfile::getCounterMax() const
+{
+  return counter_max_;
+}
+
+uint64_t E2EProfile::nextCounter(uint64_t counter) const
+{
+  return (counter >= counter_max_ ? 0 : counter + 1);
+}
+
+E2EStatus E2EProfile::checkCounter(uint64_t previous, uint64_t received) const
+{
+  // Steps can only be counted between values in range
+  if (received > counter_max_ || previous > counter_max_) {
+    return E2EStatus::WRONG_SEQUENCE;
+  }
+
+  // Steps are counted modulo counter_max_ + 1
+  const uint64_t delta =
+    (received >= previous ? received - previous : counter_max_ - previous + received + 1);
+
+  if (delta == 0) {
+    return E2EStatus::REPEATED;
+  }
+
+  return (delta <= max_counter_delta_ ? E2EStatus::OK : E2EStatus::WRONG_SEQUENCE);
+}
+
+uint8_t E2EProfile::computeChecksum(const uint8_t * frame) const
+{
+  uint8_t crc = crc_->update(data_id_crc_, frame, checksum_byte_);
+  crc = crc_->update(crc, frame + checksum_byte_ + 1, length_ - checksum_byte_ - 1);
+
+  return crc_->finish(crc);
+}
+
+void E2EProfile::writeChecksum(uint8_t * frame) const
+{
+  frame[checksum_byte_] = computeChecksum(frame);
+}
+
+bool E2EProfile::verifyChecksum(const uint8_t * frame) const
+{
+  return frame[checksum_byte_] == computeChecksum(frame);
+}
+
+// End E2EProfile
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
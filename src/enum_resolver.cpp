@@ -0,0 +1,212 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include "enum_resolver.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+namespace
+{
+
+// Key ranges up to this size always get a dense array
+constexpr uint64_t MIN_DENSE_RANGE = 64;
+// Dense arrays may be this many times larger than the key count
+constexpr uint64_t MAX_DENSE_SPARSITY = 4;
+// Dense arrays never get larger than this
+constexpr uint64_t MAX_DENSE_RANGE = 65536;
+
+}  // namespace
+
+// Begin LabelPool
+
+size_t LabelPool::add(const std::string & label)
+{
+  auto offset_itr = offsets_.find(label);
+
+  if (offset_itr != offsets_.end()) {
+    return offset_itr->second;
+  }
+
+  size_t offset = chars_.size();
+  chars_.insert(chars_.end(), label.begin(), label.end());
+  offsets_.emplace(label, offset);
+
+  return offset;
+}
+
+StringView LabelPool::view(size_t offset, size_t size) const
+{
+  StringView label;
+  label.data = chars_.data() + offset;
+  label.size = size;
+
+  return label;
+}
+
+// End LabelPool
+// Begin EnumResolver
+
+EnumResolver::EnumResolver(
+  const std::map<unsigned int, std::string> & value_descs,
+  unsigned int length,
+  bool is_signed,
+  LabelPool & pool)
+  : dense_base_(0)
+{
+  std::vector<std::pair<int64_t, std::pair<size_t, size_t>>> entries;
+
+  for (const auto & desc : value_descs) {
+    uint64_t key = desc.first;
+
+    // Keys hold negative values as 32-bit two's complement, which has
+    // to be widened before reducing to signals wider than 32 bits
+    if (is_signed) {
+      key = static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(desc.first)));
+    }
+
+    if (length > 0 && length < 64) {
+      const uint64_t mask = (uint64_t(1) << length) - 1;
+      key &= mask;
+
+      if (is_signed) {
+        const uint64_t sign_bit = uint64_t(1) << (length - 1);
+        key = (key ^ sign_bit) - sign_bit;
+      }
+    }
+
+    entries.emplace_back(
+      static_cast<int64_t>(key),
+      std::make_pair(pool.add(desc.second), desc.second.size()));
+  }
+
+  // Reducing to the signal width can reorder and collide keys.
+  // The first description listed for a value wins.
+  std::stable_sort(
+    entries.begin(), entries.end(),
+    [](const std::pair<int64_t, std::pair<size_t, size_t>> & lhs,
+    const std::pair<int64_t, std::pair<size_t, size_t>> & rhs)
+    {
+      return lhs.first < rhs.first;
+    });
+
+  for (const auto & entry : entries) {
+    if (keys_.empty() || keys_.back() != entry.first) {
+      keys_.push_back(entry.first);
+      label_refs_.push_back(entry.second);
+    }
+  }
+}
+
+void EnumResolver::finalize(const LabelPool & pool)
+{
+  labels_.clear();
+  dense_labels_.clear();
+  labels_.reserve(label_refs_.size());
+
+  for (const auto & label_ref : label_refs_) {
+    labels_.push_back(pool.view(label_ref.first, label_ref.second));
+  }
+
+  if (keys_.empty()) {
+    return;
+  }
+
+  const uint64_t range = static_cast<uint64_t>(keys_.back()) - static_cast<uint64_t>(keys_.front());
+
+  if (range < MAX_DENSE_RANGE &&
+    (range < MIN_DENSE_RANGE || range < MAX_DENSE_SPARSITY * keys_.size()))
+  {
+    dense_base_ = keys_.front();
+    dense_labels_.resize(range + 1);
+
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      const uint64_t index =
+        static_cast<uint64_t>(keys_[i]) - static_cast<uint64_t>(dense_base_);
+      dense_labels_[index] = labels_[i];
+    }
+  }
+}
+
+StringView EnumResolver::resolve(int64_t raw_value) const
+{
+  if (!dense_labels_.empty()) {
+    // Values below the base wrap around to large indices
+    const uint64_t index = static_cast<uint64_t>(raw_value) - static_cast<uint64_t>(dense_base_);
+
+    if (index < dense_labels_.size()) {
+      return dense_labels_[index];
+    }
+
+    return StringView();
+  }
+
+  auto key_itr = std::lower_bound(keys_.begin(), keys_.end(), raw_value);
+
+  if (key_itr != keys_.end() && *key_itr == raw_value) {
+    return labels_[key_itr - keys_.begin()];
+  }
+
+  return StringView();
+}
+
+void EnumResolver::resolve(const int64_t * raw_values, size_t count, StringView * labels) const
+{
+  if (!dense_labels_.empty()) {
+    const uint64_t base = static_cast<uint64_t>(dense_base_);
+    const uint64_t dense_count = dense_labels_.size();
+    const StringView * dense_labels = dense_labels_.data();
+
+    for (size_t i = 0; i < count; ++i) {
+      const uint64_t index = static_cast<uint64_t>(raw_values[i]) - base;
+      labels[i] = (index < dense_count ? dense_labels[index] : StringView());
+    }
+
+    return;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    labels[i] = resolve(raw_values[i]);
+  }
+}
+
+bool EnumResolver::isDense() const
+{
+  return !dense_labels_.empty();
+}
+
+// End EnumResolver
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
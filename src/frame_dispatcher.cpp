@@ -0,0 +1,235 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "frame_dispatcher.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+namespace
+{
+
+// Fibonacci hashing: the top bits of the product are well mixed even
+// for IDs which only differ in their low bits
+constexpr uint32_t HASH_MULTIPLIER = 0x9E3779B1u;
+// Filter bits per extended ID. With a single hash this rejects all but
+// about 1 in 32 unknown IDs before the hash map lookup.
+constexpr size_t FILTER_BITS_PER_ID = 32;
+constexpr unsigned int MIN_FILTER_BITS_LOG2 = 6;
+// Slots tried when counting an unknown extended ID. Once the table
+// fills up, busy buses with many unknown IDs would otherwise scan it
+// on every frame.
+constexpr size_t MAX_COUNTER_PROBES = 8;
+
+uint32_t mixId(unsigned int msg_id)
+{
+  return static_cast<uint32_t>(msg_id) * HASH_MULTIPLIER;
+}
+
+}  // namespace
+
+constexpr unsigned int FrameDispatcher::STANDARD_ID_COUNT;
+constexpr size_t FrameDispatcher::TRACKED_EXTENDED_IDS;
+
+FrameDispatcher::FrameDispatcher()
+  : FrameDispatcher(std::vector<unsigned int>())
+{
+}
+
+FrameDispatcher::FrameDispatcher(const std::vector<unsigned int> & codec_ids)
+  : standard_indices_(STANDARD_ID_COUNT, -1),
+    unknown_(new UnknownCounters)
+{
+  size_t extended_count = 0;
+
+  for (auto id : codec_ids) {
+    if (id >= STANDARD_ID_COUNT) {
+      ++extended_count;
+    }
+  }
+
+  // Smallest power of two with enough bits, at least one word
+  unsigned int filter_bits_log2 = MIN_FILTER_BITS_LOG2;
+
+  while ((size_t(1) << filter_bits_log2) < extended_count * FILTER_BITS_PER_ID) {
+    ++filter_bits_log2;
+  }
+
+  filter_.assign((size_t(1) << filter_bits_log2) / 64, 0);
+  filter_shift_ = 32 - filter_bits_log2;
+  extended_indices_.reserve(extended_count);
+
+  for (size_t index = 0; index < codec_ids.size(); ++index) {
+    const unsigned int id = codec_ids[index];
+
+    if (id < STANDARD_ID_COUNT) {
+      standard_indices_[id] = static_cast<int32_t>(index);
+    } else {
+      const uint32_t bit = filterBit(id);
+      filter_[bit / 64] |= uint64_t(1) << (bit % 64);
+      extended_indices_.emplace(id, static_cast<int32_t>(index));
+    }
+  }
+
+  resetUnknownIdCounts();
+}
+
+int32_t FrameDispatcher::find(unsigned int msg_id) const
+{
+  if (msg_id < STANDARD_ID_COUNT) {
+    return standard_indices_[msg_id];
+  }
+
+  const uint32_t bit = filterBit(msg_id);
+
+  if (((filter_[bit / 64] >> (bit % 64)) & 1) == 0) {
+    return -1;
+  }
+
+  auto index_itr = extended_indices_.find(msg_id);
+
+  if (index_itr != extended_indices_.end()) {
+    return index_itr->second;
+  }
+
+  return -1;
+}
+
+int32_t FrameDispatcher::dispatch(unsigned int msg_id) const
+{
+  const int32_t index = find(msg_id);
+
+  if (index < 0) {
+    countUnknown(msg_id);
+  }
+
+  return index;
+}
+
+uint64_t FrameDispatcher::getUnknownFrameCount() const
+{
+  uint64_t frame_count = unknown_->untracked.load(std::memory_order_relaxed);
+
+  for (const auto & id_count : getUnknownIdCounts()) {
+    frame_count += id_count.frame_count;
+  }
+
+  return frame_count;
+}
+
+std::vector<UnknownIdCount> FrameDispatcher::getUnknownIdCounts() const
+{
+  std::vector<UnknownIdCount> counts;
+
+  for (unsigned int id = 0; id < STANDARD_ID_COUNT; ++id) {
+    const uint64_t frame_count = unknown_->standard[id].load(std::memory_order_relaxed);
+
+    if (frame_count > 0) {
+      counts.push_back({id, frame_count});
+    }
+  }
+
+  const size_t standard_end = counts.size();
+
+  for (size_t slot = 0; slot < TRACKED_EXTENDED_IDS; ++slot) {
+    const unsigned int id = unknown_->extended_ids[slot].load(std::memory_order_relaxed);
+    const uint64_t frame_count = unknown_->extended[slot].load(std::memory_order_relaxed);
+
+    if (id != 0 && frame_count > 0) {
+      counts.push_back({id, frame_count});
+    }
+  }
+
+  std::sort(
+    counts.begin() + standard_end, counts.end(),
+    [](const UnknownIdCount & a, const UnknownIdCount & b)
+    {
+      return a.id < b.id;
+    });
+
+  return counts;
+}
+
+void FrameDispatcher::resetUnknownIdCounts() const
+{
+  unknown_->untracked.store(0, std::memory_order_relaxed);
+
+  for (auto & frame_count : unknown_->standard) {
+    frame_count.store(0, std::memory_order_relaxed);
+  }
+
+  for (size_t slot = 0; slot < TRACKED_EXTENDED_IDS; ++slot) {
+    unknown_->extended_ids[slot].store(0, std::memory_order_relaxed);
+    unknown_->extended[slot].store(0, std::memory_order_relaxed);
+  }
+}
+
+uint32_t FrameDispatcher::filterBit(unsigned int msg_id) const
+{
+  return mixId(msg_id) >> filter_shift_;
+}
+
+void FrameDispatcher::countUnknown(unsigned int msg_id) const
+{
+  if (msg_id < STANDARD_ID_COUNT) {
+    unknown_->standard[msg_id].fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  // Open addressing with linear probing. A slot is claimed once and
+  // keeps its ID until the counters are reset. The start slot comes
+  // from the top bits of the mixed ID.
+  const size_t start =
+    static_cast<size_t>((uint64_t(mixId(msg_id)) * TRACKED_EXTENDED_IDS) >> 32);
+
+  for (size_t probe = 0; probe < MAX_COUNTER_PROBES; ++probe) {
+    const size_t slot = (start + probe) % TRACKED_EXTENDED_IDS;
+    unsigned int slot_id = unknown_->extended_ids[slot].load(std::memory_order_relaxed);
+
+    if (slot_id == 0 &&
+      unknown_->extended_ids[slot].compare_exchange_strong(
+        slot_id, msg_id, std::memory_order_relaxed))
+    {
+      slot_id = msg_id;
+    }
+
+    if (slot_id == msg_id) {
+      unknown_->extended[slot].fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+
+  unknown_->untracked.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
@@ -0,0 +1,125 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include "lookup_table.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+namespace
+{
+
+// Keeps 2^length within size_t and well clear of any sane cap
+constexpr unsigned int MAX_TABLE_LENGTH = 24;
+
+}  // namespace
+
+bool LookupTableKey::operator<(const LookupTableKey & other) const
+{
+  return std::tie(length, is_signed, factor, offset) <
+         std::tie(other.length, other.is_signed, other.factor, other.offset);
+}
+
+LookupTablePool::LookupTablePool()
+  : byte_count_(0)
+{
+}
+
+void LookupTablePool::build(std::vector<LookupTableKey> keys, const LookupTableConfig & config)
+{
+  tables_.clear();
+  byte_count_ = 0;
+
+  // Narrowest first so that the cap excludes the biggest tables
+  std::sort(keys.begin(), keys.end());
+  keys.erase(
+    std::unique(
+      keys.begin(), keys.end(),
+      [](const LookupTableKey & lhs, const LookupTableKey & rhs)
+      {
+        return !(lhs < rhs) && !(rhs < lhs);
+      }),
+    keys.end());
+
+  for (const auto & key : keys) {
+    if (key.length == 0 || key.length > config.max_length || key.length > MAX_TABLE_LENGTH) {
+      continue;
+    }
+
+    const size_t entry_count = size_t(1) << key.length;
+    const size_t table_bytes = entry_count * sizeof(double);
+
+    if (byte_count_ + table_bytes > config.max_bytes) {
+      break;
+    }
+
+    auto table = std::make_shared<LookupTable>(entry_count);
+    const uint64_t sign_bit = uint64_t(1) << (key.length - 1);
+
+    // Same arithmetic as SignalTranscoder::getValue()
+    for (uint64_t bits = 0; bits < entry_count; ++bits) {
+      double raw = (key.is_signed ?
+        static_cast<double>(static_cast<int64_t>((bits ^ sign_bit) - sign_bit)) :
+        static_cast<double>(bits));
+
+      (*table)[bits] = raw * key.factor + key.offset;
+    }
+
+    tables_.emplace(key, std::move(table));
+    byte_count_ += table_bytes;
+  }
+}
+
+std::shared_ptr<const LookupTable> LookupTablePool::find(const LookupTableKey & key) const
+{
+  auto table_itr = tables_.find(key);
+
+  if (table_itr != tables_.end()) {
+    return table_itr->second;
+  }
+
+  return nullptr;
+}
+
+size_t LookupTablePool::size() const
+{
+  return tables_.size();
+}
+
+size_t LookupTablePool::getByteCount() const
+{
+  return byte_count_;
+}
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
@@ -20,6 +20,11 @@
 
 #include "message.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -32,10 +37,90 @@ namespace CAN
 namespace DbcLoader
 {
 
+namespace
+{
+
+std::string unquote(const std::string & text)
+{
+  if (text.size() >= 2 && text.front() == '"' && text.back() == '"') {
+    return text.substr(1, text.size() - 2);
+  }
+
+  return text;
+}
+
+// Leaves number alone unless the whole text is a number
+void parseNumber(const std::string & text, double & number)
+{
+  const char * begin = text.c_str();
+  char * end = nullptr;
+  double parsed = std::strtod(begin, &end);
+
+  if (end != begin && *end == '\0') {
+    number = parsed;
+  }
+}
+
+// GenSigStartValue is a raw value. FLOAT and DOUBLE signals take it
+// as the value itself since their raw bits are the IEEE encoding.
+uint64_t startRawValue(const Signal & sig, const BitPlan & plan, double start_value)
+{
+  if (sig.getValueType() != SignalValueType::INTEGER) {
+    return ieeeBits(sig.getValueType(), start_value);
+  }
+
+  // Out of range start values fall back to 0
+  if (!(std::fabs(start_value) < 9.2e18)) {
+    return 0;
+  }
+
+  uint64_t raw_value = static_cast<uint64_t>(std::llround(start_value)) & plan.mask;
+
+  // Stored sign-extended like decoded raw values
+  if ((raw_value & plan.sign_bit) != 0) {
+    raw_value |= ~plan.mask;
+  }
+
+  return raw_value;
+}
+
+// Attribute values of E2E counters and IDs must be whole and fit
+uint64_t parseE2EInteger(const std::string & text, uint64_t max_value)
+{
+  double number = -1.0;
+  parseNumber(text, number);
+
+  if (!(number >= 0.0 && number <= static_cast<double>(max_value)) ||
+    number != std::floor(number))
+  {
+    throw DbcE2EConfigException();
+  }
+
+  return static_cast<uint64_t>(number);
+}
+
+ChecksumType parseChecksumType(const std::string & text)
+{
+  if (text == "CRC8_SAE_J1850") {
+    return ChecksumType::CRC8_SAE_J1850;
+  } else if (text == "CRC8_H2F") {
+    return ChecksumType::CRC8_H2F;
+  } else if (text == "NONE") {
+    return ChecksumType::NONE;
+  }
+
+  throw DbcE2EConfigException();
+}
+
+}  // namespace
+
 Message::Message(std::string && message_text)
   : transmitting_node_(BusNode("")),
-    comment_(nullptr)
+    comment_(nullptr),
+    content_hash_(0),
+    annotation_hash_(0)
 {
+  template_frame_.fill(0);
   dbc_text_ = std::move(message_text);
   parse();
 }
@@ -50,27 +135,44 @@ Message::Message(
     name_(name),
     dlc_(dlc),
     transmitting_node_(transmitting_node),
-    comment_(nullptr)
+    comment_(nullptr),
+    content_hash_(0),
+    annotation_hash_(0)
 {
   for (auto & signal : signals) {
     signals_.emplace(std::make_pair(signal.getName(), std::move(signal)));
   }
 
+  layout_ = std::make_shared<const SignalLayout>(buildLayout());
+  updateHashes();
+  buildTemplate(std::vector<std::unique_ptr<Attribute>>());
   generateText();
 }
 
 Message::Message(const Message & other)
-  : id_(other.id_),
+  : DbcObj(other),
+    AttrObj(other),
+    id_(other.id_),
     name_(other.name_),
     dlc_(other.dlc_),
     transmitting_node_(other.transmitting_node_),
-    signals_(other.signals_)
+    signals_(other.signals_),
+    layout_(other.layout_),
+    content_hash_(other.content_hash_),
+    annotation_hash_(other.annotation_hash_),
+    start_values_(other.start_values_),
+    template_frame_(other.template_frame_),
+    e2e_config_(other.e2e_config_)
 {
   if (other.comment_) {
     comment_ = std::make_unique<std::string>(*(other.comment_));
   } else {
     comment_ = nullptr;
   }
+
+  for (const auto & sig : other.layout_signals_) {
+    layout_signals_.push_back(&(signals_.at(sig->name_)));
+  }
 }
 
 Message & Message::operator=(const Message & other)
@@ -119,13 +221,62 @@ const std::string * Message::getComment() const
   return comment_.get();
 }
 
+const SignalLayout * Message::getLayout() const
+{
+  return layout_.get();
+}
+
+std::vector<const Signal *> Message::getLayoutSignals() const
+{
+  return layout_signals_;
+}
+
+size_t Message::getContentHash() const
+{
+  return content_hash_;
+}
+
+size_t Message::getAnnotationHash() const
+{
+  return annotation_hash_;
+}
+
+std::vector<uint8_t> Message::getTemplateFrame() const
+{
+  auto payload = template_frame_.begin() + FRAME_PADDING;
+  return std::vector<uint8_t>(payload, payload + getLength());
+}
+
+const E2EConfig & Message::getE2EConfig() const
+{
+  return e2e_config_;
+}
+
+void Message::setE2EConfig(const E2EConfig & config)
+{
+  E2EConfig previous = std::move(e2e_config_);
+  e2e_config_ = config;
+
+  // Messages which haven't been through a Database get a private layout
+  if (!layout_) {
+    layout_ = std::make_shared<const SignalLayout>(buildLayout());
+  }
+
+  try {
+    E2EProfile profile(*this);
+  } catch (const DbcE2EConfigException &) {
+    e2e_config_ = std::move(previous);
+    throw;
+  }
+}
+
 void Message::generateText()
 {
   std::ostringstream output;
 
   output << "BO_ " << id_ << " ";
   output << name_ << ": ";
-  output << dlc_ << " ";
+  output << static_cast<unsigned int>(dlcToLength(dlc_)) << " ";
   output << transmitting_node_.name_;
   output << std::endl;
 
@@ -136,30 +287,417 @@ void Message::parse()
 {
   std::istringstream input(dbc_text_);
 
+  unsigned int length;
+
   input.ignore(4);
   input >> id_;
   input >> name_;
-  input >> dlc_;
+  input >> length;
   input >> transmitting_node_.name_;
 
+  // The DBC stores the payload length in bytes
+  dlc_ = lengthToDlc(static_cast<unsigned char>(std::min(length, 64u)));
+
   // Remove colon after name
   name_ = name_.substr(0, name_.length() - 1);
 }
 
+SignalLayout Message::buildLayout()
+{
+  std::vector<std::pair<SignalLayoutEntry, const Signal *>> sorted_sigs;
+
+  for (const auto & sig : signals_) {
+    sorted_sigs.emplace_back(sig.second.getLayoutEntry(), &(sig.second));
+  }
+
+  // Order by layout first so that identical layouts produce identical
+  // entry lists, then by name to keep the slot order deterministic.
+  std::sort(
+    sorted_sigs.begin(), sorted_sigs.end(),
+    [](const std::pair<SignalLayoutEntry, const Signal *> & lhs,
+    const std::pair<SignalLayoutEntry, const Signal *> & rhs)
+    {
+      if (lhs.first != rhs.first) {
+        return lhs.first < rhs.first;
+      }
+
+      return lhs.second->name_ < rhs.second->name_;
+    });
+
+  std::vector<SignalLayoutEntry> entries;
+  std::unordered_map<std::string, int> slots;
+  int implicit_switch_slot = -1;
+  layout_signals_.clear();
+
+  for (const auto & sig : sorted_sigs) {
+    const Signal * sig_ptr = sig.second;
+    int slot = static_cast<int>(entries.size());
+
+    // Without SG_MUL_VAL_ the switch is the message's top-level M signal
+    if (implicit_switch_slot < 0 && sig_ptr->is_multiplex_def_ && !sig_ptr->multiplex_id_) {
+      implicit_switch_slot = slot;
+    }
+
+    slots.emplace(sig_ptr->name_, slot);
+    entries.push_back(sig.first);
+    layout_signals_.push_back(sig_ptr);
+  }
+
+  std::vector<MuxCondition> mux_conditions(layout_signals_.size());
+  bool has_mux = false;
+
+  for (size_t slot = 0; slot < layout_signals_.size(); ++slot) {
+    const Signal * sig = layout_signals_[slot];
+
+    if (!sig->multiplex_id_) {
+      continue;
+    }
+
+    auto & condition = mux_conditions[slot];
+
+    if (sig->multiplexer_name_.empty()) {
+      condition.switch_slot = implicit_switch_slot;
+    } else {
+      auto slot_itr = slots.find(sig->multiplexer_name_);
+      condition.switch_slot = (slot_itr != slots.end() ? slot_itr->second : -1);
+    }
+
+    if (sig->multiplex_ranges_.empty()) {
+      condition.ranges.emplace_back(*(sig->multiplex_id_), *(sig->multiplex_id_));
+    } else {
+      condition.ranges = sig->multiplex_ranges_;
+    }
+
+    if (condition.switch_slot >= 0) {
+      has_mux = true;
+    }
+  }
+
+  // Messages without a usable switch decode every signal
+  if (!has_mux) {
+    mux_conditions.clear();
+  }
+
+  return SignalLayout(std::move(entries), std::move(mux_conditions));
+}
+
+void Message::buildTemplate(const std::vector<std::unique_ptr<Attribute>> & attribute_defs)
+{
+  double default_start_value = 0.0;
+
+  for (const auto & attr : attribute_defs) {
+    if (attr->getDbcObjType() != DbcObjType::SIGNAL ||
+      unquote(attr->getName()) != START_VALUE_ATTR)
+    {
+      continue;
+    }
+
+    if (attr->getAttrType() == AttributeType::INT) {
+      const int * value = static_cast<const IntAttribute *>(attr.get())->getDefaultValue();
+      default_start_value = (value != nullptr ? *value : 0.0);
+    } else if (attr->getAttrType() == AttributeType::FLOAT) {
+      const float * value = static_cast<const FloatAttribute *>(attr.get())->getDefaultValue();
+      default_start_value = (value != nullptr ? *value : 0.0);
+    }
+  }
+
+  const auto & plans = layout_->getPlans();
+  start_values_.assign(plans.size(), 0);
+
+  for (size_t slot = 0; slot < plans.size(); ++slot) {
+    const Signal * sig = layout_signals_[slot];
+    double start_value = default_start_value;
+    auto value_itr = sig->attribute_values_.find(START_VALUE_ATTR);
+
+    if (value_itr != sig->attribute_values_.end()) {
+      parseNumber(value_itr->second, start_value);
+    }
+
+    start_values_[slot] = startRawValue(*sig, plans[slot], start_value);
+  }
+
+  template_frame_.fill(0);
+
+  auto insert =
+    [this, &plans](uint32_t slot)
+    {
+      plans[slot].insert(template_frame_.data(), start_values_[slot]);
+    };
+
+  const MuxTree & mux_tree = layout_->getMuxTree();
+
+  if (!mux_tree.isMultiplexed()) {
+    for (uint32_t slot = 0; slot < plans.size(); ++slot) {
+      insert(slot);
+    }
+  } else {
+    mux_tree.walk(
+      [&insert](const uint32_t * slots, size_t count)
+      {
+        for (size_t i = 0; i < count; ++i) {
+          insert(slots[i]);
+        }
+      },
+      [this](uint32_t slot)
+      {
+        return start_values_[slot];
+      });
+  }
+}
+
+void Message::loadE2EConfig(const std::vector<std::unique_ptr<Attribute>> & attribute_defs)
+{
+  E2EConfig config;
+  bool configured = false;
+
+  auto find_value =
+    [this, &configured](const std::string & attr_name) -> const std::string *
+    {
+      auto value_itr = attribute_values_.find(attr_name);
+
+      if (value_itr == attribute_values_.end()) {
+        return nullptr;
+      }
+
+      configured = true;
+      return &(value_itr->second);
+    };
+
+  if (const std::string * value = find_value(E2E_COUNTER_SIGNAL_ATTR)) {
+    config.counter_signal = unquote(*value);
+  }
+
+  if (const std::string * value = find_value(E2E_COUNTER_MAX_ATTR)) {
+    config.counter_max = parseE2EInteger(*value, UINT32_MAX);
+  }
+
+  if (const std::string * value = find_value(E2E_MAX_DELTA_COUNTER_ATTR)) {
+    config.max_counter_delta = parseE2EInteger(*value, UINT32_MAX);
+  }
+
+  if (const std::string * value = find_value(E2E_CHECKSUM_SIGNAL_ATTR)) {
+    config.checksum_signal = unquote(*value);
+  }
+
+  if (const std::string * value = find_value(E2E_DATA_ID_ATTR)) {
+    config.data_id = static_cast<uint16_t>(parseE2EInteger(*value, UINT16_MAX));
+  }
+
+  if (const std::string * value = find_value(E2E_CHECKSUM_TYPE_ATTR)) {
+    std::string type_name = unquote(*value);
+
+    // Values of ENUM attributes are indexes into the definition's list
+    for (const auto & attr : attribute_defs) {
+      if (attr->getDbcObjType() == DbcObjType::MESSAGE &&
+        attr->getAttrType() == AttributeType::ENUM &&
+        unquote(attr->getName()) == E2E_CHECKSUM_TYPE_ATTR)
+      {
+        auto enum_values = static_cast<const EnumAttribute *>(attr.get())->getEnumValues();
+        uint64_t index = parseE2EInteger(type_name, UINT32_MAX);
+
+        if (index >= enum_values.size()) {
+          throw DbcE2EConfigException();
+        }
+
+        type_name = *(enum_values[index]);
+      }
+    }
+
+    config.checksum_type = parseChecksumType(type_name);
+  }
+
+  if (configured) {
+    setE2EConfig(config);
+  }
+}
+
+void Message::updateHashes()
+{
+  std::hash<std::string> str_hash;
+
+  // Slot order is deterministic so the signal hashes
+  // can be combined in order
+  content_hash_ = id_;
+  hashCombine(content_hash_, str_hash(name_));
+  hashCombine(content_hash_, dlc_);
+  hashCombine(content_hash_, str_hash(transmitting_node_.name_));
+
+  annotation_hash_ = (comment_ ? str_hash(*comment_) : 0);
+  hashCombine(annotation_hash_, hashAttrValues(attribute_values_));
+
+  for (const auto & sig : layout_signals_) {
+    hashCombine(content_hash_, sig->getContentHash());
+    hashCombine(annotation_hash_, sig->comment_ ? str_hash(*(sig->comment_)) : 0);
+    hashCombine(annotation_hash_, hashAttrValues(sig->attribute_values_));
+  }
+}
+
 unsigned char Message::dlcToLength(const unsigned char & dlc)
 {
   return DLC_LENGTH[dlc];
 }
 
-MessageTranscoder::MessageTranscoder(Message * dbc_msg)
+unsigned char Message::lengthToDlc(const unsigned char & length)
+{
+  unsigned char dlc = 0;
+
+  // Smallest DLC which can hold the payload
+  while (dlc < DLC_LENGTH.size() - 1 && DLC_LENGTH[dlc] < length) {
+    dlc++;
+  }
+
+  return dlc;
+}
+
+MessageTranscoder::MessageTranscoder(
+  Message * dbc_msg,
+  const LookupTablePool * lookup_tables,
+  uint32_t message_index)
   : msg_def_(dbc_msg),
-    data_()
+    message_index_(message_index),
+    layout_(dbc_msg->layout_),
+    length_(dbc_msg->getLength()),
+    data_(),
+    has_last_frame_(false),
+    from_template_(true),
+    tx_counter_(0),
+    rx_counter_(0),
+    has_rx_counter_(false),
+    e2e_status_(E2EStatus::OK)
 {
-  data_.assign(Message::dlcToLength(dbc_msg->getDlc()), 0);
+  data_.assign(length_, 0);
+  last_frame_.fill(0);
+
+  // Messages which haven't been through a Database get a private layout
+  if (!layout_) {
+    layout_ = std::make_shared<const SignalLayout>(msg_def_->buildLayout());
+    msg_def_->layout_ = layout_;
+  }
+
+  if (msg_def_->start_values_.size() != layout_->getPlans().size()) {
+    msg_def_->buildTemplate(std::vector<std::unique_ptr<Attribute>>());
+  }
+
+  e2e_ = E2EProfile(*msg_def_);
+
+  const auto & plans = layout_->getPlans();
+  signal_xcoders_.reserve(plans.size());
+
+  for (size_t i = 0; i < plans.size(); ++i) {
+    const Signal * sig = msg_def_->layout_signals_[i];
+    signal_xcoders_.emplace_back(sig, plans[i]);
+    signal_indices_.emplace(sig->getName(), i);
 
-  for (auto sig = msg_def_->signals_.begin(); sig != msg_def_->signals_.end(); ++sig) {
-    signal_xcoders_.emplace(sig->first, &(sig->second));
+    if (lookup_tables != nullptr && sig->getValueType() == SignalValueType::INTEGER) {
+      auto & xcoder = signal_xcoders_.back();
+      xcoder.lookup_table_ = lookup_tables->find(
+        LookupTableKey{sig->getLength(), sig->isSigned(), xcoder.factor_, xcoder.offset_});
+
+      if (xcoder.lookup_table_) {
+        xcoder.lookup_values_ = xcoder.lookup_table_->data();
+      }
+    }
+  }
+
+  // Switches and the signals they select can't be patched in alone:
+  // changing them changes which signals the frame holds. Neither can
+  // overlapping signals, whose shared bits depend on encode order.
+  const auto & mux_conditions = layout_->getMuxConditions();
+
+  for (size_t i = 0; i < plans.size(); ++i) {
+    signal_xcoders_[i].raw_value_ = msg_def_->start_values_[i];
+    signal_xcoders_[i].patchable_ =
+      mux_conditions.empty() || mux_conditions[i].switch_slot < 0;
+  }
+
+  for (const auto & condition : mux_conditions) {
+    if (condition.switch_slot >= 0) {
+      signal_xcoders_[condition.switch_slot].patchable_ = false;
+    }
   }
+
+  for (const auto & overlap : layout_->getOverlaps()) {
+    signal_xcoders_[overlap.first].patchable_ = false;
+    signal_xcoders_[overlap.second].patchable_ = false;
+  }
+
+  changed_slots_.reserve(plans.size());
+  bindSignals();
+
+  was_active_.assign(plans.size(), 0);
+}
+
+MessageTranscoder::MessageTranscoder(const MessageTranscoder & other)
+  : msg_def_(other.msg_def_),
+    message_index_(other.message_index_),
+    layout_(other.layout_),
+    length_(other.length_),
+    data_(other.data_),
+    last_frame_(other.last_frame_),
+    has_last_frame_(other.has_last_frame_),
+    was_active_(other.was_active_),
+    signal_xcoders_(other.signal_xcoders_),
+    signal_indices_(other.signal_indices_),
+    changed_slots_(other.changed_slots_),
+    from_template_(other.from_template_),
+    e2e_(other.e2e_),
+    tx_counter_(other.tx_counter_),
+    rx_counter_(other.rx_counter_),
+    has_rx_counter_(other.has_rx_counter_),
+    e2e_status_(other.e2e_status_)
+{
+  bindSignals();
+}
+
+MessageTranscoder::MessageTranscoder(MessageTranscoder && other)
+  : msg_def_(other.msg_def_),
+    message_index_(other.message_index_),
+    layout_(std::move(other.layout_)),
+    length_(other.length_),
+    data_(std::move(other.data_)),
+    last_frame_(other.last_frame_),
+    has_last_frame_(other.has_last_frame_),
+    was_active_(std::move(other.was_active_)),
+    signal_xcoders_(std::move(other.signal_xcoders_)),
+    signal_indices_(std::move(other.signal_indices_)),
+    changed_slots_(std::move(other.changed_slots_)),
+    from_template_(other.from_template_),
+    e2e_(other.e2e_),
+    tx_counter_(other.tx_counter_),
+    rx_counter_(other.rx_counter_),
+    has_rx_counter_(other.has_rx_counter_),
+    e2e_status_(other.e2e_status_)
+{
+  bindSignals();
+}
+
+MessageTranscoder & MessageTranscoder::operator=(const MessageTranscoder & other)
+{
+  return *this = MessageTranscoder(other);
+}
+
+MessageTranscoder & MessageTranscoder::operator=(MessageTranscoder && other)
+{
+  msg_def_ = other.msg_def_;
+  message_index_ = other.message_index_;
+  layout_ = std::move(other.layout_);
+  length_ = other.length_;
+  data_ = std::move(other.data_);
+  last_frame_ = other.last_frame_;
+  has_last_frame_ = other.has_last_frame_;
+  was_active_ = std::move(other.was_active_);
+  signal_xcoders_ = std::move(other.signal_xcoders_);
+  signal_indices_ = std::move(other.signal_indices_);
+  changed_slots_ = std::move(other.changed_slots_);
+  from_template_ = other.from_template_;
+  e2e_ = other.e2e_;
+  tx_counter_ = other.tx_counter_;
+  rx_counter_ = other.rx_counter_;
+  has_rx_counter_ = other.has_rx_counter_;
+  e2e_status_ = other.e2e_status_;
+  bindSignals();
+
+  return *this;
 }
 
 const Message * MessageTranscoder::getMessageDef()
@@ -167,24 +705,473 @@ const Message * MessageTranscoder::getMessageDef()
   return msg_def_;
 }
 
-void MessageTranscoder::decode(std::vector<uint8_t> && raw_data, TranscodeError * err)
+uint32_t MessageTranscoder::getMessageIndex() const
+{
+  return message_index_;
+}
+
+const SignalTranscoder * MessageTranscoder::getSignal(const std::string & signal_name) const
+{
+  auto index_itr = signal_indices_.find(signal_name);
+
+  if (index_itr != signal_indices_.end()) {
+    return &(signal_xcoders_[index_itr->second]);
+  }
+
+  return nullptr;
+}
+
+SignalTranscoder * MessageTranscoder::getSignal(const std::string & signal_name)
+{
+  auto index_itr = signal_indices_.find(signal_name);
+
+  if (index_itr != signal_indices_.end()) {
+    return &(signal_xcoders_[index_itr->second]);
+  }
+
+  return nullptr;
+}
+
+const SignalTranscoder * MessageTranscoder::getSignal(const SignalHandle & handle) const
+{
+  if (handle.slot < signal_xcoders_.size() &&
+    (message_index_ == SignalHandle::INVALID || handle.message_index == message_index_))
+  {
+    return &(signal_xcoders_[handle.slot]);
+  }
+
+  return nullptr;
+}
+
+SignalTranscoder * MessageTranscoder::getSignal(const SignalHandle & handle)
+{
+  if (handle.slot < signal_xcoders_.size() &&
+    (message_index_ == SignalHandle::INVALID || handle.message_index == message_index_))
+  {
+    return &(signal_xcoders_[handle.slot]);
+  }
+
+  return nullptr;
+}
+
+int MessageTranscoder::getSlot(const std::string & signal_name) const
+{
+  auto index_itr = signal_indices_.find(signal_name);
+
+  if (index_itr != signal_indices_.end()) {
+    return static_cast<int>(index_itr->second);
+  }
+
+  return -1;
+}
+
+TranscodeErrorType MessageTranscoder::decode(std::vector<uint8_t> && raw_data)
 {
   data_ = std::move(raw_data);
-  decodeRawData(err);
+  return decode(data_.data(), data_.size());
+}
+
+TranscodeErrorType MessageTranscoder::decode(const uint8_t * frame, size_t frame_length)
+{
+  if (frame_length < length_) {
+    return TranscodeErrorType::INVALID_LENGTH;
+  }
+
+  // Only payload bytes are ever written, so the padding stays zero
+  std::memcpy(last_frame_.data() + FRAME_PADDING, frame, length_);
+  has_last_frame_ = true;
+  from_template_ = false;
+  checkE2E();
+
+  const MuxTree & mux_tree = layout_->getMuxTree();
+
+  if (!mux_tree.isMultiplexed()) {
+    for (auto & xcoder : signal_xcoders_) {
+      xcoder.raw_value_ = xcoder.plan_.extract(last_frame_.data());
+    }
+
+    return TranscodeErrorType::NONE;
+  }
+
+  for (auto & xcoder : signal_xcoders_) {
+    xcoder.raw_value_ = 0;
+    xcoder.active_ = false;
+  }
+
+  mux_tree.walk(
+    [this](const uint32_t * slots, size_t count)
+    {
+      for (size_t i = 0; i < count; ++i) {
+        auto & xcoder = signal_xcoders_[slots[i]];
+        xcoder.raw_value_ = xcoder.plan_.extract(last_frame_.data());
+        xcoder.active_ = true;
+      }
+    },
+    [this](uint32_t slot)
+    {
+      return signal_xcoders_[slot].raw_value_;
+    });
+
+  return TranscodeErrorType::NONE;
 }
 
-void MessageTranscoder::decodeRawData(TranscodeError * err)
+TranscodeErrorType MessageTranscoder::decode(const std::array<uint8_t, MAX_FRAME_LENGTH> & frame)
 {
-  err = new TranscodeError(TranscodeErrorType::NONE, "");
+  return decode(frame.data(), frame.size());
+}
+
+TranscodeErrorType MessageTranscoder::decodeDelta(
+  const uint8_t * frame,
+  size_t frame_length,
+  std::vector<uint32_t> & changed_slots)
+{
+  if (frame_length < length_) {
+    return TranscodeErrorType::INVALID_LENGTH;
+  }
+
+  changed_slots.clear();
+  from_template_ = false;
+
+  if (!has_last_frame_) {
+    decode(frame, frame_length);
+
+    for (size_t slot = 0; slot < signal_xcoders_.size(); ++slot) {
+      if (signal_xcoders_[slot].active_) {
+        changed_slots.push_back(static_cast<uint32_t>(slot));
+      }
+    }
+
+    return TranscodeErrorType::NONE;
+  }
+
+  // The last frame is zero past the payload, so whole words can be
+  // compared. The extra word keeps SignalMask::high in bounds.
+  const size_t full_words = length_ / 8;
+  const size_t tail_length = length_ % 8;
+  uint64_t changed_bits[PAYLOAD_WORDS + 1] = {};
+  uint64_t any_changed = 0;
+
+  for (size_t word = 0; word < full_words; ++word) {
+    changed_bits[word] =
+      loadLe64(last_frame_.data() + FRAME_PADDING + word * 8) ^ loadLe64(frame + word * 8);
+    any_changed |= changed_bits[word];
+  }
+
+  if (tail_length > 0) {
+    uint8_t tail[8] = {};
+    std::memcpy(tail, frame + full_words * 8, tail_length);
+    changed_bits[full_words] =
+      loadLe64(last_frame_.data() + FRAME_PADDING + full_words * 8) ^ loadLe64(tail);
+    any_changed |= changed_bits[full_words];
+  }
+
+  if (any_changed == 0) {
+    checkE2E();
+    return TranscodeErrorType::NONE;
+  }
+
+  std::memcpy(last_frame_.data() + FRAME_PADDING, frame, length_);
+  checkE2E();
 
-  // TODO(jwhitleyastuff): Do the thing.
+  const auto & signal_masks = layout_->getSignalMasks();
+
+  auto signal_changed = [&signal_masks, &changed_bits](size_t slot)
+    {
+      const SignalMask & signal_mask = signal_masks[slot];
+
+      return ((changed_bits[signal_mask.word] & signal_mask.low) |
+             (changed_bits[signal_mask.word + 1] & signal_mask.high)) != 0;
+    };
+
+  const MuxTree & mux_tree = layout_->getMuxTree();
+
+  if (!mux_tree.isMultiplexed()) {
+    // Collected without branching, then only the changed ones decoded
+    const size_t count = signal_xcoders_.size();
+    size_t changed_count = 0;
+    changed_slots.resize(count);
+
+    for (size_t slot = 0; slot < count; ++slot) {
+      changed_slots[changed_count] = static_cast<uint32_t>(slot);
+      changed_count += signal_changed(slot);
+    }
+
+    changed_slots.resize(changed_count);
+
+    for (auto slot : changed_slots) {
+      auto & xcoder = signal_xcoders_[slot];
+      xcoder.raw_value_ = xcoder.plan_.extract(last_frame_.data());
+    }
+
+    return TranscodeErrorType::NONE;
+  }
+
+  for (size_t slot = 0; slot < signal_xcoders_.size(); ++slot) {
+    was_active_[slot] = signal_xcoders_[slot].active_;
+    signal_xcoders_[slot].active_ = false;
+  }
+
+  // Unchanged switches keep their decoded values, so the walk can
+  // use them directly
+  mux_tree.walk(
+    [this, &signal_changed, &changed_slots](const uint32_t * slots, size_t count)
+    {
+      for (size_t i = 0; i < count; ++i) {
+        auto & xcoder = signal_xcoders_[slots[i]];
+        xcoder.active_ = true;
+
+        if (!was_active_[slots[i]] || signal_changed(slots[i])) {
+          xcoder.raw_value_ = xcoder.plan_.extract(last_frame_.data());
+          changed_slots.push_back(slots[i]);
+        }
+      }
+    },
+    [this](uint32_t slot)
+    {
+      return signal_xcoders_[slot].raw_value_;
+    });
+
+  for (size_t slot = 0; slot < signal_xcoders_.size(); ++slot) {
+    if (was_active_[slot] && !signal_xcoders_[slot].active_) {
+      signal_xcoders_[slot].raw_value_ = 0;
+      changed_slots.push_back(static_cast<uint32_t>(slot));
+    }
+  }
+
+  std::sort(changed_slots.begin(), changed_slots.end());
+
+  return TranscodeErrorType::NONE;
+}
+
+void MessageTranscoder::resetDelta()
+{
+  has_last_frame_ = false;
 }
 
 std::vector<uint8_t> MessageTranscoder::encode(TranscodeError * err)
 {
+  data_.resize(length_);
+
+  TranscodeErrorType err_type = encode(data_.data(), data_.size());
+
+  if (err != nullptr) {
+    *err = TranscodeError(err_type, "");
+  }
+
   return std::vector<uint8_t>(data_.begin(), data_.end());
 }
 
+TranscodeErrorType MessageTranscoder::encode(uint8_t * frame, size_t frame_length)
+{
+  return encode(frame, frame_length, RangePolicy::IGNORE);
+}
+
+TranscodeErrorType MessageTranscoder::encode(std::array<uint8_t, MAX_FRAME_LENGTH> & frame)
+{
+  return encode(frame.data(), frame.size());
+}
+
+TranscodeErrorType MessageTranscoder::encode(
+  uint8_t * frame,
+  size_t frame_length,
+  RangePolicy policy,
+  std::vector<uint64_t> * violations)
+{
+  if (frame_length < length_) {
+    return TranscodeErrorType::INVALID_LENGTH;
+  }
+
+  const bool check_range = (policy != RangePolicy::IGNORE || violations != nullptr);
+
+  if (from_template_ && !check_range) {
+    bool patchable = true;
+
+    for (auto slot : changed_slots_) {
+      patchable = patchable && signal_xcoders_[slot].patchable_;
+    }
+
+    if (patchable) {
+      PaddedFrame padded_frame = msg_def_->template_frame_;
+
+      for (auto slot : changed_slots_) {
+        const auto & xcoder = signal_xcoders_[slot];
+        xcoder.plan_.insert(padded_frame.data(), xcoder.raw_value_);
+      }
+
+      protect(padded_frame);
+      std::memcpy(frame, padded_frame.data() + FRAME_PADDING, length_);
+
+      return TranscodeErrorType::NONE;
+    }
+  }
+
+  bool violated = false;
+
+  if (violations != nullptr) {
+    violations->assign(violationMaskWords(signal_xcoders_.size()), 0);
+  }
+
+  PaddedFrame padded_frame;
+  padded_frame.fill(0);
+
+  auto insert =
+    [this, policy, violations, check_range, &violated, &padded_frame](uint32_t slot)
+    {
+      const auto & xcoder = signal_xcoders_[slot];
+      uint64_t raw_value = xcoder.raw_value_;
+
+      if (check_range && !xcoder.isInRange()) {
+        violated = true;
+
+        if (violations != nullptr) {
+          (*violations)[slot / 64] |= uint64_t(1) << (slot % 64);
+        }
+
+        if (policy == RangePolicy::CLAMP) {
+          raw_value = xcoder.getClampedRawValue();
+        }
+      }
+
+      xcoder.plan_.insert(padded_frame.data(), raw_value);
+    };
+
+  const MuxTree & mux_tree = layout_->getMuxTree();
+
+  if (!mux_tree.isMultiplexed()) {
+    for (uint32_t slot = 0; slot < signal_xcoders_.size(); ++slot) {
+      insert(slot);
+    }
+  } else {
+    // Only the page selected by the current switch values is written
+    mux_tree.walk(
+      [&insert](const uint32_t * slots, size_t count)
+      {
+        for (size_t i = 0; i < count; ++i) {
+          insert(slots[i]);
+        }
+      },
+      [this](uint32_t slot)
+      {
+        return signal_xcoders_[slot].raw_value_;
+      });
+  }
+
+  if (violated && policy == RangePolicy::REJECT) {
+    return TranscodeErrorType::OUT_OF_RANGE;
+  }
+
+  protect(padded_frame);
+  std::memcpy(frame, padded_frame.data() + FRAME_PADDING, length_);
+
+  return TranscodeErrorType::NONE;
+}
+
+bool MessageTranscoder::validate(std::vector<uint64_t> & violations) const
+{
+  bool violated = false;
+
+  violations.assign(violationMaskWords(signal_xcoders_.size()), 0);
+
+  for (size_t slot = 0; slot < signal_xcoders_.size(); ++slot) {
+    const auto & xcoder = signal_xcoders_[slot];
+
+    if (xcoder.active_ && !xcoder.isInRange()) {
+      violations[slot / 64] |= uint64_t(1) << (slot % 64);
+      violated = true;
+    }
+  }
+
+  return violated;
+}
+
+void MessageTranscoder::resetToTemplate()
+{
+  for (size_t slot = 0; slot < signal_xcoders_.size(); ++slot) {
+    auto & xcoder = signal_xcoders_[slot];
+    xcoder.raw_value_ = msg_def_->start_values_[slot];
+    xcoder.active_ = true;
+    xcoder.changed_ = false;
+  }
+
+  changed_slots_.clear();
+  from_template_ = true;
+}
+
+const E2EProfile & MessageTranscoder::getE2EProfile() const
+{
+  return e2e_;
+}
+
+E2EStatus MessageTranscoder::getE2EStatus() const
+{
+  return e2e_status_;
+}
+
+void MessageTranscoder::resetE2E()
+{
+  tx_counter_ = 0;
+  rx_counter_ = 0;
+  has_rx_counter_ = false;
+  e2e_status_ = E2EStatus::OK;
+}
+
+void MessageTranscoder::checkE2E()
+{
+  if (!e2e_.isEnabled()) {
+    return;
+  }
+
+  // Frames with a bad checksum don't advance the receive counter
+  if (e2e_.getChecksumSlot() >= 0 && !e2e_.verifyChecksum(last_frame_.data() + FRAME_PADDING)) {
+    e2e_status_ = E2EStatus::BAD_CHECKSUM;
+    return;
+  }
+
+  const int counter_slot = e2e_.getCounterSlot();
+
+  if (counter_slot < 0) {
+    e2e_status_ = E2EStatus::OK;
+    return;
+  }
+
+  const BitPlan & plan = signal_xcoders_[counter_slot].plan_;
+  const uint64_t counter = plan.extract(last_frame_.data()) & plan.mask;
+
+  // Neither do counters past E2ECounterMax, which no sender produces
+  if (counter > e2e_.getCounterMax()) {
+    e2e_status_ = E2EStatus::WRONG_SEQUENCE;
+    return;
+  }
+
+  e2e_status_ =
+    (has_rx_counter_ ? e2e_.checkCounter(rx_counter_, counter) : E2EStatus::INITIAL);
+  rx_counter_ = counter;
+  has_rx_counter_ = true;
+}
+
+void MessageTranscoder::protect(PaddedFrame & padded_frame)
+{
+  const int counter_slot = e2e_.getCounterSlot();
+
+  if (counter_slot >= 0) {
+    signal_xcoders_[counter_slot].plan_.insert(padded_frame.data(), tx_counter_);
+    tx_counter_ = e2e_.nextCounter(tx_counter_);
+  }
+
+  // Last, so that it covers the counter
+  if (e2e_.getChecksumSlot() >= 0) {
+    e2e_.writeChecksum(padded_frame.data() + FRAME_PADDING);
+  }
+}
+
+void MessageTranscoder::bindSignals()
+{
+  for (size_t slot = 0; slot < signal_xcoders_.size(); ++slot) {
+    signal_xcoders_[slot].changed_slots_ = &changed_slots_;
+    signal_xcoders_[slot].slot_ = static_cast<uint32_t>(slot);
+  }
+}
+
 }  // namespace DbcLoader
 }  // namespace CAN
 }  // namespace AS
@@ -0,0 +1,481 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "message_codec.hpp"
+#include "scaling_kernels.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+namespace
+{
+
+// Frames staged per pass of decodeBatch(). Small enough that the
+// staged frames and one chunk of every column stay in L1/L2.
+constexpr size_t BATCH_CHUNK = MAX_COLUMN_CHUNK;
+
+}  // namespace
+
+MessageCodec::MessageCodec(const Message & dbc_msg, uint32_t message_index)
+  : id_(dbc_msg.id_),
+    message_index_(message_index),
+    length_(dbc_msg.getLength()),
+    batch_pitch_(0),
+    layout_(dbc_msg.layout_),
+    has_ieee_slots_(false)
+{
+  std::vector<const Signal *> layout_signals = dbc_msg.layout_signals_;
+  std::unique_ptr<Message> msg_copy;
+
+  // Messages which haven't been through a Database get a private layout
+  if (!layout_) {
+    msg_copy.reset(new Message(dbc_msg));
+    layout_ = std::make_shared<const SignalLayout>(msg_copy->buildLayout());
+    layout_signals = msg_copy->layout_signals_;
+    msg_copy->layout_ = layout_;
+  }
+
+  e2e_ = E2EProfile(msg_copy ? *msg_copy : dbc_msg);
+
+  const auto & entries = layout_->getEntries();
+
+  factors_.reserve(entries.size());
+  offsets_.reserve(entries.size());
+  mins_.reserve(entries.size());
+  maxs_.reserve(entries.size());
+  signal_names_.reserve(entries.size());
+
+  // Staged batch frames need zeros behind every byte a plan can read,
+  // which may be past the message length for malformed signals.
+  size_t padded_length = length_;
+
+  for (const auto & plan : layout_->getPlans()) {
+    padded_length = std::max<size_t>(padded_length, plan.end_byte);
+  }
+
+  batch_pitch_ = FRAME_PADDING + ((padded_length + 7) / 8) * 8;
+
+  for (size_t i = 0; i < entries.size(); ++i) {
+    factors_.push_back(entries[i].factor);
+    offsets_.push_back(entries[i].offset);
+    mins_.push_back(layout_signals[i]->getMinVal());
+    maxs_.push_back(layout_signals[i]->getMaxVal());
+    signal_names_.push_back(layout_signals[i]->getName());
+    slots_.emplace(signal_names_.back(), static_cast<int>(i));
+    has_ieee_slots_ = has_ieee_slots_ || entries[i].value_type != SignalValueType::INTEGER;
+  }
+}
+
+unsigned int MessageCodec::getId() const
+{
+  return id_;
+}
+
+uint32_t MessageCodec::getMessageIndex() const
+{
+  return message_index_;
+}
+
+size_t MessageCodec::getLength() const
+{
+  return length_;
+}
+
+size_t MessageCodec::getSignalCount() const
+{
+  return signal_names_.size();
+}
+
+const std::vector<std::string> & MessageCodec::getSignalNames() const
+{
+  return signal_names_;
+}
+
+int MessageCodec::getSlot(const std::string & signal_name) const
+{
+  auto slot_itr = slots_.find(signal_name);
+
+  if (slot_itr != slots_.end()) {
+    return slot_itr->second;
+  }
+
+  return -1;
+}
+
+const SignalLayout * MessageCodec::getLayout() const
+{
+  return layout_.get();
+}
+
+const E2EProfile & MessageCodec::getE2EProfile() const
+{
+  return e2e_;
+}
+
+TranscodeErrorType MessageCodec::decode(
+  const uint8_t * frame, size_t frame_length, Output & output) const
+{
+  if (frame_length < length_) {
+    return TranscodeErrorType::INVALID_LENGTH;
+  }
+
+  const auto & plans = layout_->getPlans();
+  const size_t count = plans.size();
+
+  // No-ops once the Output has been used with this message
+  output.raw_values.resize(count);
+  output.values.resize(count);
+  output.active.resize(count);
+
+  PaddedFrame padded_frame;
+  padded_frame.fill(0);
+  std::memcpy(padded_frame.data() + FRAME_PADDING, frame, length_);
+
+  const MuxTree & mux_tree = layout_->getMuxTree();
+
+  if (mux_tree.isMultiplexed()) {
+    std::fill(output.raw_values.begin(), output.raw_values.end(), 0);
+    std::fill(output.values.begin(), output.values.end(), 0.0);
+    std::fill(output.active.begin(), output.active.end(), 0);
+
+    const auto & entries = layout_->getEntries();
+
+    // Switches are always visited before the slots they select
+    mux_tree.walk(
+      [this, &plans, &entries, &padded_frame, &output](const uint32_t * slots, size_t slot_count)
+      {
+        for (size_t i = 0; i < slot_count; ++i) {
+          const uint32_t slot = slots[i];
+          int64_t raw = static_cast<int64_t>(plans[slot].extract(padded_frame.data()));
+
+          output.raw_values[slot] = raw;
+          output.active[slot] = 1;
+
+          if (entries[slot].value_type != SignalValueType::INTEGER) {
+            output.values[slot] = ieeePhysical(
+              entries[slot].value_type, static_cast<uint64_t>(raw),
+              factors_[slot], offsets_[slot]);
+            continue;
+          }
+
+          double raw_double = (plans[slot].sign_bit != 0 ?
+            static_cast<double>(raw) :
+            static_cast<double>(static_cast<uint64_t>(raw)));
+
+          output.values[slot] = raw_double * factors_[slot] + offsets_[slot];
+        }
+      },
+      [&output](uint32_t slot)
+      {
+        return output.raw_values[slot];
+      });
+
+    return TranscodeErrorType::NONE;
+  }
+
+  std::fill(output.active.begin(), output.active.end(), 1);
+
+  getBitPlanKernels().extractFrame(
+    plans.data(), count, padded_frame.data(), output.raw_values.data());
+
+  for (size_t i = 0; i < count; ++i) {
+    int64_t raw = output.raw_values[i];
+    double raw_double = (plans[i].sign_bit != 0 ?
+      static_cast<double>(raw) :
+      static_cast<double>(static_cast<uint64_t>(raw)));
+
+    output.values[i] = raw_double * factors_[i] + offsets_[i];
+  }
+
+  if (has_ieee_slots_) {
+    const auto & entries = layout_->getEntries();
+
+    for (size_t i = 0; i < count; ++i) {
+      if (entries[i].value_type != SignalValueType::INTEGER) {
+        output.values[i] = ieeePhysical(
+          entries[i].value_type, static_cast<uint64_t>(output.raw_values[i]),
+          factors_[i], offsets_[i]);
+      }
+    }
+  }
+
+  return TranscodeErrorType::NONE;
+}
+
+template<typename FrameAt>
+void MessageCodec::decodeColumns(FrameAt frame_at, size_t frame_count, BatchOutput & output) const
+{
+  const auto & plans = layout_->getPlans();
+  const auto & entries = layout_->getEntries();
+  const size_t count = plans.size();
+  const BitPlanKernels & plan_kernels = getBitPlanKernels();
+  const ScalingKernels & kernels = getScalingKernels();
+
+  output.frame_count = frame_count;
+  output.raw_values.resize(count * frame_count);
+  output.values.resize(count * frame_count);
+
+  // Only frame bytes are ever written to the scratch buffer, so the
+  // padding stays zero as long as neither the pitch nor the message
+  // length changes. A longer message of the same pitch would leave its
+  // trailing bytes behind for signals which reach past the length.
+  if (output.scratch_pitch != batch_pitch_ || output.scratch_length != length_) {
+    output.scratch.assign(BATCH_CHUNK * batch_pitch_ + FRAME_PADDING, 0);
+    output.scratch_pitch = batch_pitch_;
+    output.scratch_length = length_;
+  }
+
+  for (size_t first = 0; first < frame_count; first += BATCH_CHUNK) {
+    const size_t chunk_count = std::min(BATCH_CHUNK, frame_count - first);
+
+    for (size_t i = 0; i < chunk_count; ++i) {
+      std::memcpy(
+        output.scratch.data() + i * batch_pitch_ + FRAME_PADDING,
+        frame_at(first + i),
+        length_);
+    }
+
+    for (size_t slot = 0; slot < count; ++slot) {
+      int64_t * raw_column = output.raw_values.data() + slot * frame_count + first;
+
+      plan_kernels.extractColumn(
+        plans[slot], output.scratch.data(), batch_pitch_, chunk_count, raw_column);
+
+      double * value_column = output.values.data() + slot * frame_count + first;
+
+      if (entries[slot].value_type != SignalValueType::INTEGER) {
+        // The bits already are the value, so no integer scaling
+        for (size_t i = 0; i < chunk_count; ++i) {
+          value_column[i] = ieeePhysical(
+            entries[slot].value_type, static_cast<uint64_t>(raw_column[i]),
+            factors_[slot], offsets_[slot]);
+        }
+
+        continue;
+      }
+
+      auto scale = (plans[slot].sign_bit != 0 ? kernels.scaleSigned : kernels.scaleUnsigned);
+      scale(raw_column, chunk_count, factors_[slot], offsets_[slot], value_column);
+    }
+  }
+
+  const MuxTree & mux_tree = layout_->getMuxTree();
+
+  if (!mux_tree.isMultiplexed()) {
+    output.active.clear();
+    return;
+  }
+
+  // Switch columns are already decoded, so marking the selected
+  // slots only needs the tree walk per frame.
+  output.active.assign(count * frame_count, 0);
+
+  for (size_t frame_index = 0; frame_index < frame_count; ++frame_index) {
+    mux_tree.walk(
+      [&output, frame_count, frame_index](const uint32_t * slots, size_t slot_count)
+      {
+        for (size_t i = 0; i < slot_count; ++i) {
+          output.active[slots[i] * frame_count + frame_index] = 1;
+        }
+      },
+      [&output, frame_count, frame_index](uint32_t slot)
+      {
+        return output.raw_values[slot * frame_count + frame_index];
+      });
+  }
+}
+
+TranscodeErrorType MessageCodec::decodeBatch(
+  const uint8_t * frames,
+  size_t frame_count,
+  size_t frame_stride,
+  BatchOutput & output) const
+{
+  if (frame_stride < length_) {
+    return TranscodeErrorType::INVALID_LENGTH;
+  }
+
+  decodeColumns(
+    [frames, frame_stride](size_t frame_index)
+    {
+      return frames + frame_index * frame_stride;
+    },
+    frame_count, output);
+
+  return TranscodeErrorType::NONE;
+}
+
+TranscodeErrorType MessageCodec::decodeBatch(
+  const uint8_t * const * frames,
+  size_t frame_count,
+  BatchOutput & output) const
+{
+  decodeColumns(
+    [frames](size_t frame_index)
+    {
+      return frames[frame_index];
+    },
+    frame_count, output);
+
+  return TranscodeErrorType::NONE;
+}
+
+void MessageCodec::clampBatch(BatchOutput & output) const
+{
+  const ScalingKernels & kernels = getScalingKernels();
+
+  for (size_t slot = 0; slot < mins_.size(); ++slot) {
+    // DBCs commonly leave the range as [0|0] when it isn't known
+    if (mins_[slot] < maxs_[slot]) {
+      kernels.clamp(
+        output.values.data() + slot * output.frame_count, output.frame_count,
+        mins_[slot], maxs_[slot]);
+    }
+  }
+}
+
+bool MessageCodec::validate(Output & output) const
+{
+  const size_t count = mins_.size();
+  bool violated = false;
+
+  output.violations.assign(violationMaskWords(count), 0);
+
+  for (size_t slot = 0; slot < count; ++slot) {
+    const double value = output.values[slot];
+
+    if (mins_[slot] < maxs_[slot] && output.active[slot] != 0 &&
+      !(value >= mins_[slot] && value <= maxs_[slot]))
+    {
+      output.violations[slot / 64] |= uint64_t(1) << (slot % 64);
+      violated = true;
+    }
+  }
+
+  return violated;
+}
+
+size_t MessageCodec::validateBatch(BatchOutput & output) const
+{
+  const ScalingKernels & kernels = getScalingKernels();
+  const size_t count = mins_.size();
+  const size_t words = violationMaskWords(count);
+
+  output.violation_words = words;
+  output.violations.assign(output.frame_count * words, 0);
+
+  size_t flagged = 0;
+
+  for (size_t slot = 0; slot < count; ++slot) {
+    if (mins_[slot] < maxs_[slot]) {
+      flagged += kernels.flagRange(
+        output.values.data() + slot * output.frame_count, output.frame_count,
+        mins_[slot], maxs_[slot], uint64_t(1) << (slot % 64),
+        output.violations.data() + slot / 64, words);
+    }
+  }
+
+  if (flagged == 0) {
+    return 0;
+  }
+
+  size_t violated_frames = 0;
+
+  for (size_t frame_index = 0; frame_index < output.frame_count; ++frame_index) {
+    uint64_t * masks = output.violations.data() + frame_index * words;
+
+    // Slots the multiplexer didn't select decode as zero, which
+    // says nothing about the signal
+    if (!output.active.empty()) {
+      for (size_t slot = 0; slot < count; ++slot) {
+        if (output.active[slot * output.frame_count + frame_index] == 0) {
+          masks[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+        }
+      }
+    }
+
+    uint64_t any = 0;
+
+    for (size_t word = 0; word < words; ++word) {
+      any |= masks[word];
+    }
+
+    violated_frames += (any != 0 ? 1 : 0);
+  }
+
+  return violated_frames;
+}
+
+TranscodeErrorType MessageCodec::encode(
+  const Output & input, uint8_t * frame, size_t frame_length) const
+{
+  const auto & plans = layout_->getPlans();
+
+  if (frame_length < length_ || input.raw_values.size() < plans.size()) {
+    return TranscodeErrorType::INVALID_LENGTH;
+  }
+
+  PaddedFrame padded_frame;
+  padded_frame.fill(0);
+
+  const MuxTree & mux_tree = layout_->getMuxTree();
+
+  if (mux_tree.isMultiplexed()) {
+    mux_tree.walk(
+      [&plans, &input, &padded_frame](const uint32_t * slots, size_t slot_count)
+      {
+        for (size_t i = 0; i < slot_count; ++i) {
+          plans[slots[i]].insert(
+            padded_frame.data(), static_cast<uint64_t>(input.raw_values[slots[i]]));
+        }
+      },
+      [&input](uint32_t slot)
+      {
+        return input.raw_values[slot];
+      });
+  } else {
+    getBitPlanKernels().insertFrame(
+      plans.data(), plans.size(), input.raw_values.data(), padded_frame.data());
+  }
+
+  if (e2e_.getChecksumSlot() >= 0) {
+    e2e_.writeChecksum(padded_frame.data() + FRAME_PADDING);
+  }
+
+  std::memcpy(frame, padded_frame.data() + FRAME_PADDING, length_);
+
+  return TranscodeErrorType::NONE;
+}
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
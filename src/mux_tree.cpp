@@ -0,0 +1,235 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "mux_tree.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+namespace
+{
+
+// Switches whose values all fit below this get a direct lookup table
+constexpr uint64_t DIRECT_TABLE_SIZE = 1024;
+
+}  // namespace
+
+bool MuxCondition::operator==(const MuxCondition & other) const
+{
+  return switch_slot == other.switch_slot && ranges == other.ranges;
+}
+
+bool MuxCondition::operator!=(const MuxCondition & other) const
+{
+  return !(*this == other);
+}
+
+MuxTree::MuxTree(const std::vector<MuxCondition> & conditions)
+{
+  const size_t count = conditions.size();
+  std::vector<std::vector<uint32_t>> children(count);
+  Node root;
+
+  for (size_t slot = 0; slot < count; ++slot) {
+    int switch_slot = conditions[slot].switch_slot;
+
+    if (switch_slot >= 0 &&
+      static_cast<size_t>(switch_slot) < count &&
+      static_cast<size_t>(switch_slot) != slot)
+    {
+      children[switch_slot].push_back(static_cast<uint32_t>(slot));
+    } else {
+      root.slots.push_back(static_cast<uint32_t>(slot));
+    }
+  }
+
+  nodes_.push_back(std::move(root));
+
+  std::vector<int32_t> switch_indices(count, -1);
+  addSwitches(0, children, conditions, switch_indices);
+
+  // Every slot has a single parent switch, so the only slots not
+  // reached from the root are ones whose switches form a cycle.
+  // Decode those unconditionally rather than never.
+  std::vector<bool> reached(count, false);
+
+  for (const auto & node : nodes_) {
+    for (auto slot : node.slots) {
+      reached[slot] = true;
+    }
+  }
+
+  for (size_t slot = 0; slot < count; ++slot) {
+    if (!reached[slot]) {
+      nodes_[0].slots.push_back(static_cast<uint32_t>(slot));
+    }
+  }
+}
+
+bool MuxTree::isMultiplexed() const
+{
+  return !switches_.empty();
+}
+
+int32_t MuxTree::Switch::find(uint64_t value) const
+{
+  if (value < table.size()) {
+    return table[value];
+  }
+
+  // Last interval starting at or before value
+  auto start_itr = std::upper_bound(starts.begin(), starts.end(), value);
+
+  if (start_itr == starts.begin()) {
+    return -1;
+  }
+
+  return nodes[start_itr - starts.begin() - 1];
+}
+
+void MuxTree::addSwitches(
+  size_t node_index,
+  const std::vector<std::vector<uint32_t>> & children,
+  const std::vector<MuxCondition> & conditions,
+  std::vector<int32_t> & switch_indices)
+{
+  // Copied because nodes_ grows while the switches are built
+  std::vector<uint32_t> slots = nodes_[node_index].slots;
+
+  for (auto slot : slots) {
+    if (children[slot].empty()) {
+      continue;
+    }
+
+    // A switch can appear in several pages of its own parent switch
+    if (switch_indices[slot] < 0) {
+      switch_indices[slot] = static_cast<int32_t>(
+        buildSwitch(slot, children, conditions, switch_indices));
+    }
+
+    nodes_[node_index].switches.push_back(static_cast<uint32_t>(switch_indices[slot]));
+  }
+}
+
+uint32_t MuxTree::buildSwitch(
+  uint32_t slot,
+  const std::vector<std::vector<uint32_t>> & children,
+  const std::vector<MuxCondition> & conditions,
+  std::vector<int32_t> & switch_indices)
+{
+  // Split the value space at every range boundary. Each resulting
+  // interval selects a fixed set of child slots.
+  std::vector<uint64_t> points;
+
+  for (auto child : children[slot]) {
+    for (const auto & range : conditions[child].ranges) {
+      if (range.first <= range.second) {
+        points.push_back(range.first);
+        points.push_back(static_cast<uint64_t>(range.second) + 1);
+      }
+    }
+  }
+
+  std::sort(points.begin(), points.end());
+  points.erase(std::unique(points.begin(), points.end()), points.end());
+
+  Switch mux_switch;
+  mux_switch.slot = slot;
+
+  // Intervals selecting the same slots share a node
+  std::map<std::vector<uint32_t>, int32_t> node_indices;
+  std::vector<size_t> new_nodes;
+
+  for (size_t i = 0; i + 1 < points.size(); ++i) {
+    std::vector<uint32_t> selected;
+
+    for (auto child : children[slot]) {
+      for (const auto & range : conditions[child].ranges) {
+        if (range.first <= points[i] && points[i] <= range.second) {
+          selected.push_back(child);
+          break;
+        }
+      }
+    }
+
+    int32_t node_index = -1;
+
+    if (!selected.empty()) {
+      auto node_itr = node_indices.find(selected);
+
+      if (node_itr != node_indices.end()) {
+        node_index = node_itr->second;
+      } else {
+        node_index = static_cast<int32_t>(nodes_.size());
+        node_indices.emplace(selected, node_index);
+        new_nodes.push_back(nodes_.size());
+
+        Node node;
+        node.slots = std::move(selected);
+        nodes_.push_back(std::move(node));
+      }
+    }
+
+    mux_switch.starts.push_back(points[i]);
+    mux_switch.nodes.push_back(node_index);
+  }
+
+  if (!points.empty()) {
+    // Nothing is selected past the last range
+    mux_switch.starts.push_back(points.back());
+    mux_switch.nodes.push_back(-1);
+
+    if (points.back() <= DIRECT_TABLE_SIZE) {
+      mux_switch.table.assign(points.back(), -1);
+
+      for (size_t i = 0; i + 1 < points.size(); ++i) {
+        for (uint64_t value = points[i]; value < points[i + 1]; ++value) {
+          mux_switch.table[value] = mux_switch.nodes[i];
+        }
+      }
+    }
+  }
+
+  uint32_t switch_index = static_cast<uint32_t>(switches_.size());
+  switches_.push_back(std::move(mux_switch));
+  switch_indices[slot] = static_cast<int32_t>(switch_index);
+
+  // Nested switches (extended multiplexing)
+  for (auto node_index : new_nodes) {
+    addSwitches(node_index, children, conditions, switch_indices);
+  }
+
+  return switch_index;
+}
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
@@ -0,0 +1,486 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "scaling_kernels.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define DBC_LOADER_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+// This file is built with floating-point contraction disabled so that
+// no path turns the multiply and add into an FMA.
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+namespace
+{
+
+// Begin scalar kernels
+
+void scaleSignedScalar(
+  const int64_t * raw, size_t count, double factor, double offset, double * values)
+{
+  for (size_t i = 0; i < count; ++i) {
+    values[i] = static_cast<double>(raw[i]) * factor + offset;
+  }
+}
+
+void scaleUnsignedScalar(
+  const int64_t * raw, size_t count, double factor, double offset, double * values)
+{
+  for (size_t i = 0; i < count; ++i) {
+    values[i] = static_cast<double>(static_cast<uint64_t>(raw[i])) * factor + offset;
+  }
+}
+
+// Written to match the x86 MAXPD/MINPD operand rules, which return
+// the second operand when either is NaN.
+void clampScalar(double * values, size_t count, double min, double max)
+{
+  for (size_t i = 0; i < count; ++i) {
+    double value = values[i];
+    value = (min > value ? min : value);
+    value = (max < value ? max : value);
+    values[i] = value;
+  }
+}
+
+size_t flagRangeScalar(
+  const double * values, size_t count, double min, double max,
+  uint64_t bit, uint64_t * masks, size_t mask_stride)
+{
+  size_t flagged = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    if (!(values[i] >= min && values[i] <= max)) {
+      masks[i * mask_stride] |= bit;
+      ++flagged;
+    }
+  }
+
+  return flagged;
+}
+
+// Sets the bit for each lane set in lane_mask. Violations are rare,
+// so the vector loops only come here when a lane is flagged.
+inline size_t flagLanes(
+  unsigned int lane_mask, uint64_t bit, uint64_t * masks, size_t mask_stride)
+{
+  size_t flagged = 0;
+
+  while (lane_mask != 0) {
+    const unsigned int lane = static_cast<unsigned int>(__builtin_ctz(lane_mask));
+    masks[lane * mask_stride] |= bit;
+    lane_mask &= lane_mask - 1;
+    ++flagged;
+  }
+
+  return flagged;
+}
+
+// End scalar kernels
+
+#ifdef DBC_LOADER_X86_KERNELS
+
+// Exact int64/uint64 to double conversions for targets without
+// AVX-512DQ. The value is split into two halves which are each
+// converted exactly with magic-number bias, so the final add is the
+// only rounding step, as in a scalar conversion.
+//
+// 2^52, 2^84, 2^84 + 2^52, 3 * 2^67 and 3 * 2^67 + 2^52
+const double MAGIC_2P52 = 4503599627370496.0;
+const double MAGIC_2P84 = 19342813113834066795298816.0;
+const double MAGIC_2P84_2P52 = 19342813118337666422669312.0;
+const double MAGIC_3P67 = 442721857769029238784.0;
+const double MAGIC_3P67_2P52 = 442726361368656609280.0;
+
+// Begin SSE4.2 kernels
+
+__attribute__((target("sse4.2")))
+inline __m128d uint64ToDoubleSse(__m128i x)
+{
+  __m128i high = _mm_srli_epi64(x, 32);
+  high = _mm_or_si128(high, _mm_castpd_si128(_mm_set1_pd(MAGIC_2P84)));
+  __m128i low = _mm_blend_epi16(x, _mm_castpd_si128(_mm_set1_pd(MAGIC_2P52)), 0xcc);
+  __m128d high_double = _mm_sub_pd(_mm_castsi128_pd(high), _mm_set1_pd(MAGIC_2P84_2P52));
+  return _mm_add_pd(high_double, _mm_castsi128_pd(low));
+}
+
+__attribute__((target("sse4.2")))
+inline __m128d int64ToDoubleSse(__m128i x)
+{
+  __m128i high = _mm_srai_epi32(x, 16);
+  high = _mm_blend_epi16(high, _mm_setzero_si128(), 0x33);
+  high = _mm_add_epi64(high, _mm_castpd_si128(_mm_set1_pd(MAGIC_3P67)));
+  __m128i low = _mm_blend_epi16(x, _mm_castpd_si128(_mm_set1_pd(MAGIC_2P52)), 0x88);
+  __m128d high_double = _mm_sub_pd(_mm_castsi128_pd(high), _mm_set1_pd(MAGIC_3P67_2P52));
+  return _mm_add_pd(high_double, _mm_castsi128_pd(low));
+}
+
+__attribute__((target("sse4.2")))
+void scaleSignedSse(
+  const int64_t * raw, size_t count, double factor, double offset, double * values)
+{
+  const __m128d factor_vec = _mm_set1_pd(factor);
+  const __m128d offset_vec = _mm_set1_pd(offset);
+  size_t i = 0;
+
+  for (; i + 2 <= count; i += 2) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(raw + i));
+    __m128d value = _mm_add_pd(_mm_mul_pd(int64ToDoubleSse(x), factor_vec), offset_vec);
+    _mm_storeu_pd(values + i, value);
+  }
+
+  scaleSignedScalar(raw + i, count - i, factor, offset, values + i);
+}
+
+__attribute__((target("sse4.2")))
+void scaleUnsignedSse(
+  const int64_t * raw, size_t count, double factor, double offset, double * values)
+{
+  const __m128d factor_vec = _mm_set1_pd(factor);
+  const __m128d offset_vec = _mm_set1_pd(offset);
+  size_t i = 0;
+
+  for (; i + 2 <= count; i += 2) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(raw + i));
+    __m128d value = _mm_add_pd(_mm_mul_pd(uint64ToDoubleSse(x), factor_vec), offset_vec);
+    _mm_storeu_pd(values + i, value);
+  }
+
+  scaleUnsignedScalar(raw + i, count - i, factor, offset, values + i);
+}
+
+__attribute__((target("sse4.2")))
+void clampSse(double * values, size_t count, double min, double max)
+{
+  const __m128d min_vec = _mm_set1_pd(min);
+  const __m128d max_vec = _mm_set1_pd(max);
+  size_t i = 0;
+
+  for (; i + 2 <= count; i += 2) {
+    __m128d value = _mm_loadu_pd(values + i);
+    value = _mm_max_pd(min_vec, value);
+    value = _mm_min_pd(max_vec, value);
+    _mm_storeu_pd(values + i, value);
+  }
+
+  clampScalar(values + i, count - i, min, max);
+}
+
+// NGE and NLE are true for NaN as well
+__attribute__((target("sse4.2")))
+size_t flagRangeSse(
+  const double * values, size_t count, double min, double max,
+  uint64_t bit, uint64_t * masks, size_t mask_stride)
+{
+  const __m128d min_vec = _mm_set1_pd(min);
+  const __m128d max_vec = _mm_set1_pd(max);
+  size_t flagged = 0;
+  size_t i = 0;
+
+  for (; i + 2 <= count; i += 2) {
+    __m128d value = _mm_loadu_pd(values + i);
+    __m128d outside = _mm_or_pd(_mm_cmpnge_pd(value, min_vec), _mm_cmpnle_pd(value, max_vec));
+    const unsigned int lane_mask = static_cast<unsigned int>(_mm_movemask_pd(outside));
+
+    if (lane_mask != 0) {
+      flagged += flagLanes(lane_mask, bit, masks + i * mask_stride, mask_stride);
+    }
+  }
+
+  return flagged + flagRangeScalar(
+    values + i, count - i, min, max, bit, masks + i * mask_stride, mask_stride);
+}
+
+// End SSE4.2 kernels
+// Begin AVX2 kernels
+
+__attribute__((target("avx2")))
+inline __m256d uint64ToDoubleAvx2(__m256i x)
+{
+  __m256i high = _mm256_srli_epi64(x, 32);
+  high = _mm256_or_si256(high, _mm256_castpd_si256(_mm256_set1_pd(MAGIC_2P84)));
+  __m256i low = _mm256_blend_epi16(x, _mm256_castpd_si256(_mm256_set1_pd(MAGIC_2P52)), 0xcc);
+  __m256d high_double = _mm256_sub_pd(_mm256_castsi256_pd(high), _mm256_set1_pd(MAGIC_2P84_2P52));
+  return _mm256_add_pd(high_double, _mm256_castsi256_pd(low));
+}
+
+__attribute__((target("avx2")))
+inline __m256d int64ToDoubleAvx2(__m256i x)
+{
+  __m256i high = _mm256_srai_epi32(x, 16);
+  high = _mm256_blend_epi16(high, _mm256_setzero_si256(), 0x33);
+  high = _mm256_add_epi64(high, _mm256_castpd_si256(_mm256_set1_pd(MAGIC_3P67)));
+  __m256i low = _mm256_blend_epi16(x, _mm256_castpd_si256(_mm256_set1_pd(MAGIC_2P52)), 0x88);
+  __m256d high_double = _mm256_sub_pd(_mm256_castsi256_pd(high), _mm256_set1_pd(MAGIC_3P67_2P52));
+  return _mm256_add_pd(high_double, _mm256_castsi256_pd(low));
+}
+
+__attribute__((target("avx2")))
+void scaleSignedAvx2(
+  const int64_t * raw, size_t count, double factor, double offset, double * values)
+{
+  const __m256d factor_vec = _mm256_set1_pd(factor);
+  const __m256d offset_vec = _mm256_set1_pd(offset);
+  size_t i = 0;
+
+  for (; i + 4 <= count; i += 4) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(raw + i));
+    __m256d value = _mm256_add_pd(_mm256_mul_pd(int64ToDoubleAvx2(x), factor_vec), offset_vec);
+    _mm256_storeu_pd(values + i, value);
+  }
+
+  scaleSignedScalar(raw + i, count - i, factor, offset, values + i);
+}
+
+__attribute__((target("avx2")))
+void scaleUnsignedAvx2(
+  const int64_t * raw, size_t count, double factor, double offset, double * values)
+{
+  const __m256d factor_vec = _mm256_set1_pd(factor);
+  const __m256d offset_vec = _mm256_set1_pd(offset);
+  size_t i = 0;
+
+  for (; i + 4 <= count; i += 4) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(raw + i));
+    __m256d value = _mm256_add_pd(_mm256_mul_pd(uint64ToDoubleAvx2(x), factor_vec), offset_vec);
+    _mm256_storeu_pd(values + i, value);
+  }
+
+  scaleUnsignedScalar(raw + i, count - i, factor, offset, values + i);
+}
+
+__attribute__((target("avx2")))
+void clampAvx2(double * values, size_t count, double min, double max)
+{
+  const __m256d min_vec = _mm256_set1_pd(min);
+  const __m256d max_vec = _mm256_set1_pd(max);
+  size_t i = 0;
+
+  for (; i + 4 <= count; i += 4) {
+    __m256d value = _mm256_loadu_pd(values + i);
+    value = _mm256_max_pd(min_vec, value);
+    value = _mm256_min_pd(max_vec, value);
+    _mm256_storeu_pd(values + i, value);
+  }
+
+  clampScalar(values + i, count - i, min, max);
+}
+
+__attribute__((target("avx2")))
+size_t flagRangeAvx2(
+  const double * values, size_t count, double min, double max,
+  uint64_t bit, uint64_t * masks, size_t mask_stride)
+{
+  const __m256d min_vec = _mm256_set1_pd(min);
+  const __m256d max_vec = _mm256_set1_pd(max);
+  size_t flagged = 0;
+  size_t i = 0;
+
+  for (; i + 4 <= count; i += 4) {
+    __m256d value = _mm256_loadu_pd(values + i);
+    __m256d outside = _mm256_or_pd(
+      _mm256_cmp_pd(value, min_vec, _CMP_NGE_UQ),
+      _mm256_cmp_pd(value, max_vec, _CMP_NLE_UQ));
+    const unsigned int lane_mask = static_cast<unsigned int>(_mm256_movemask_pd(outside));
+
+    if (lane_mask != 0) {
+      flagged += flagLanes(lane_mask, bit, masks + i * mask_stride, mask_stride);
+    }
+  }
+
+  return flagged + flagRangeScalar(
+    values + i, count - i, min, max, bit, masks + i * mask_stride, mask_stride);
+}
+
+// End AVX2 kernels
+// Begin AVX-512 kernels
+
+__attribute__((target("avx512f,avx512dq")))
+void scaleSignedAvx512(
+  const int64_t * raw, size_t count, double factor, double offset, double * values)
+{
+  const __m512d factor_vec = _mm512_set1_pd(factor);
+  const __m512d offset_vec = _mm512_set1_pd(offset);
+  size_t i = 0;
+
+  for (; i + 8 <= count; i += 8) {
+    __m512i x = _mm512_loadu_si512(raw + i);
+    __m512d value = _mm512_add_pd(_mm512_mul_pd(_mm512_cvtepi64_pd(x), factor_vec), offset_vec);
+    _mm512_storeu_pd(values + i, value);
+  }
+
+  scaleSignedScalar(raw + i, count - i, factor, offset, values + i);
+}
+
+__attribute__((target("avx512f,avx512dq")))
+void scaleUnsignedAvx512(
+  const int64_t * raw, size_t count, double factor, double offset, double * values)
+{
+  const __m512d factor_vec = _mm512_set1_pd(factor);
+  const __m512d offset_vec = _mm512_set1_pd(offset);
+  size_t i = 0;
+
+  for (; i + 8 <= count; i += 8) {
+    __m512i x = _mm512_loadu_si512(raw + i);
+    __m512d value = _mm512_add_pd(_mm512_mul_pd(_mm512_cvtepu64_pd(x), factor_vec), offset_vec);
+    _mm512_storeu_pd(values + i, value);
+  }
+
+  scaleUnsignedScalar(raw + i, count - i, factor, offset, values + i);
+}
+
+__attribute__((target("avx512f")))
+void clampAvx512(double * values, size_t count, double min, double max)
+{
+  const __m512d min_vec = _mm512_set1_pd(min);
+  const __m512d max_vec = _mm512_set1_pd(max);
+  size_t i = 0;
+
+  for (; i + 8 <= count; i += 8) {
+    __m512d value = _mm512_loadu_pd(values + i);
+    value = _mm512_max_pd(min_vec, value);
+    value = _mm512_min_pd(max_vec, value);
+    _mm512_storeu_pd(values + i, value);
+  }
+
+  clampScalar(values + i, count - i, min, max);
+}
+
+__attribute__((target("avx512f")))
+size_t flagRangeAvx512(
+  const double * values, size_t count, double min, double max,
+  uint64_t bit, uint64_t * masks, size_t mask_stride)
+{
+  const __m512d min_vec = _mm512_set1_pd(min);
+  const __m512d max_vec = _mm512_set1_pd(max);
+  size_t flagged = 0;
+  size_t i = 0;
+
+  for (; i + 8 <= count; i += 8) {
+    __m512d value = _mm512_loadu_pd(values + i);
+    const __mmask8 outside =
+      _mm512_cmp_pd_mask(value, min_vec, _CMP_NGE_UQ) |
+      _mm512_cmp_pd_mask(value, max_vec, _CMP_NLE_UQ);
+
+    if (outside != 0) {
+      flagged += flagLanes(outside, bit, masks + i * mask_stride, mask_stride);
+    }
+  }
+
+  return flagged + flagRangeScalar(
+    values + i, count - i, min, max, bit, masks + i * mask_stride, mask_stride);
+}
+
+// End AVX-512 kernels
+
+#endif  // DBC_LOADER_X86_KERNELS
+
+const ScalingKernels SCALAR_KERNELS =
+{SimdLevel::SCALAR, scaleSignedScalar, scaleUnsignedScalar, clampScalar, flagRangeScalar};
+
+#ifdef DBC_LOADER_X86_KERNELS
+const ScalingKernels SSE4_2_KERNELS =
+{SimdLevel::SSE4_2, scaleSignedSse, scaleUnsignedSse, clampSse, flagRangeSse};
+const ScalingKernels AVX2_KERNELS =
+{SimdLevel::AVX2, scaleSignedAvx2, scaleUnsignedAvx2, clampAvx2, flagRangeAvx2};
+const ScalingKernels AVX512_KERNELS =
+{SimdLevel::AVX512, scaleSignedAvx512, scaleUnsignedAvx512, clampAvx512,
+  flagRangeAvx512};
+#endif
+
+bool cpuSupports(SimdLevel level)
+{
+#ifdef DBC_LOADER_X86_KERNELS
+  __builtin_cpu_init();
+
+  switch (level) {
+    case SimdLevel::SCALAR:
+      return true;
+    case SimdLevel::SSE4_2:
+      return __builtin_cpu_supports("sse4.2");
+    case SimdLevel::AVX2:
+      return __builtin_cpu_supports("avx2");
+    case SimdLevel::AVX512:
+      return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq");
+  }
+
+  return false;
+#else
+  return level == SimdLevel::SCALAR;
+#endif
+}
+
+const ScalingKernels & selectScalingKernels()
+{
+  for (auto level : {SimdLevel::AVX512, SimdLevel::AVX2, SimdLevel::SSE4_2}) {
+    auto kernels = getScalingKernels(level);
+
+    if (kernels != nullptr) {
+      return *kernels;
+    }
+  }
+
+  return SCALAR_KERNELS;
+}
+
+}  // namespace
+
+const ScalingKernels & getScalingKernels()
+{
+  static const ScalingKernels & kernels = selectScalingKernels();
+  return kernels;
+}
+
+const ScalingKernels * getScalingKernels(SimdLevel level)
+{
+  if (!cpuSupports(level)) {
+    return nullptr;
+  }
+
+  switch (level) {
+#ifdef DBC_LOADER_X86_KERNELS
+    case SimdLevel::SSE4_2:
+      return &SSE4_2_KERNELS;
+    case SimdLevel::AVX2:
+      return &AVX2_KERNELS;
+    case SimdLevel::AVX512:
+      return &AVX512_KERNELS;
+#endif
+    default:
+      return &SCALAR_KERNELS;
+  }
+}
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
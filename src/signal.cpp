@@ -20,6 +20,9 @@
 
 #include "signal.hpp"
 
+#include <climits>
+#include <cmath>
+#include <functional>
 #include <map>
 #include <memory>
 #include <sstream>
@@ -34,6 +37,10 @@ namespace DbcLoader
 {
 
 Signal::Signal(std::string && dbc_text)
+  : is_multiplex_def_(false),
+    multiplex_id_(nullptr),
+    value_type_(SignalValueType::INTEGER),
+    comment_(nullptr)
 {
   dbc_text_ = std::move(dbc_text);
   parse();
@@ -43,7 +50,7 @@ Signal::Signal(
   std::string && name,
   bool is_multiplex_def,
   unsigned int multiplex_id,
-  unsigned char start_bit,
+  unsigned short start_bit,
   unsigned char length,
   Order endianness,
   bool is_signed,
@@ -61,6 +68,7 @@ Signal::Signal(
     length_(length),
     endianness_(endianness),
     is_signed_(is_signed),
+    value_type_(SignalValueType::INTEGER),
     factor_(factor),
     offset_(offset),
     min_(min),
@@ -74,12 +82,17 @@ Signal::Signal(
 }
 
 Signal::Signal(const Signal & other)
-  : name_(other.name_),
+  : DbcObj(other),
+    AttrObj(other),
+    name_(other.name_),
     is_multiplex_def_(other.is_multiplex_def_),
+    multiplexer_name_(other.multiplexer_name_),
+    multiplex_ranges_(other.multiplex_ranges_),
     start_bit_(other.start_bit_),
     length_(other.length_),
     endianness_(other.endianness_),
     is_signed_(other.is_signed_),
+    value_type_(other.value_type_),
     factor_(other.factor_),
     offset_(other.offset_),
     min_(other.min_),
@@ -121,7 +134,17 @@ const unsigned int * Signal::getMultiplexId() const
   return multiplex_id_.get();
 }
 
-unsigned char Signal::getStartBit() const
+std::string Signal::getMultiplexerName() const
+{
+  return multiplexer_name_;
+}
+
+std::vector<std::pair<unsigned int, unsigned int>> Signal::getMultiplexRanges() const
+{
+  return multiplex_ranges_;
+}
+
+unsigned short Signal::getStartBit() const
 {
   return start_bit_;
 }
@@ -141,6 +164,11 @@ bool Signal::isSigned() const
   return is_signed_;
 }
 
+SignalValueType Signal::getValueType() const
+{
+  return value_type_;
+}
+
 float Signal::getFactor() const
 {
   return factor_;
@@ -193,20 +221,80 @@ const std::string * Signal::getComment() const
   return comment_.get();
 }
 
+size_t Signal::getContentHash() const
+{
+  std::hash<std::string> str_hash;
+  size_t seed = str_hash(name_);
+
+  hashCombine(seed, is_multiplex_def_);
+  hashCombine(seed, multiplex_id_ ? *multiplex_id_ + 1 : 0);
+  hashCombine(seed, str_hash(multiplexer_name_));
+
+  for (const auto & range : multiplex_ranges_) {
+    hashCombine(seed, range.first);
+    hashCombine(seed, range.second);
+  }
+
+  hashCombine(seed, start_bit_);
+  hashCombine(seed, length_);
+  hashCombine(seed, static_cast<size_t>(endianness_));
+  hashCombine(seed, is_signed_);
+  hashCombine(seed, static_cast<size_t>(value_type_));
+  hashCombine(seed, floatBits(factor_));
+  hashCombine(seed, floatBits(offset_));
+  hashCombine(seed, floatBits(min_));
+  hashCombine(seed, floatBits(max_));
+  hashCombine(seed, str_hash(unit_));
+
+  for (const auto & node : receiving_nodes_) {
+    hashCombine(seed, str_hash(node.name_));
+  }
+
+  for (const auto & desc : value_descs_) {
+    hashCombine(seed, desc.first);
+    hashCombine(seed, str_hash(desc.second));
+  }
+
+  return seed;
+}
+
+SignalLayoutEntry Signal::getLayoutEntry() const
+{
+  SignalLayoutEntry entry;
+
+  entry.start_bit = start_bit_;
+  entry.length = length_;
+  entry.endianness = endianness_;
+  entry.is_signed = is_signed_;
+  entry.value_type = value_type_;
+  entry.factor = factor_;
+  entry.offset = offset_;
+  entry.is_multiplex_def = is_multiplex_def_;
+  entry.is_multiplexed = (multiplex_id_ != nullptr);
+  entry.multiplex_id = (multiplex_id_ != nullptr ? *multiplex_id_ : 0);
+
+  return entry;
+}
+
 void Signal::generateText()
 {
   std::ostringstream output;
 
   output << " SG_ " << name_;
 
-  if (is_multiplex_def_) {
-    output << " M";
-  } else if (multiplex_id_) {
+  if (multiplex_id_) {
     output << " m" << *multiplex_id_;
+
+    // Multiplexed multiplexer switch (extended multiplexing)
+    if (is_multiplex_def_) {
+      output << "M";
+    }
+  } else if (is_multiplex_def_) {
+    output << " M";
   }
 
-  output << " : " << start_bit_ << "|";
-  output << length_ << "@";
+  output << " : " << static_cast<unsigned int>(start_bit_) << "|";
+  output << static_cast<unsigned int>(length_) << "@";
 
   if (endianness_ == Order::LE) {
     output << 1;
@@ -255,7 +343,13 @@ void Signal::parse()
     if (temp_string == "M") {
       is_multiplex_def_ = true;
     } else {
-      // Assumed to be multiplex identifier
+      // Assumed to be multiplex identifier, optionally followed
+      // by M for a multiplexed switch (extended multiplexing)
+      if (temp_string.back() == 'M') {
+        is_multiplex_def_ = true;
+        temp_string.pop_back();
+      }
+
       multiplex_id_ = std::make_unique<unsigned int>(
         static_cast<unsigned int>(
           std::stoul(
@@ -271,8 +365,16 @@ void Signal::parse()
   auto at = temp_string.find("@");
 
   if (bar != std::string::npos && at != std::string::npos) {
-    start_bit_ = static_cast<unsigned char>(std::stoul(temp_string.substr(0, bar)));
-    length_ = static_cast<unsigned char>(std::stoul(temp_string.substr(bar + 1, at - bar - 1)));
+    const unsigned long start_bit = std::stoul(temp_string.substr(0, bar));
+    const unsigned long length = std::stoul(temp_string.substr(bar + 1, at - bar - 1));
+
+    // Rejected rather than truncated into a different, valid position
+    if (start_bit > USHRT_MAX || length > UCHAR_MAX) {
+      throw DbcParseException();
+    }
+
+    start_bit_ = static_cast<unsigned short>(start_bit);
+    length_ = static_cast<unsigned char>(length);
 
     if (temp_string[at + 1] == '0') {
       endianness_ = Order::BE;
@@ -341,9 +443,183 @@ void Signal::parse()
   }
 }
 
-SignalTranscoder::SignalTranscoder(Signal * dbc_sig)
-  : sig_def_(dbc_sig)
+SignalTranscoder::SignalTranscoder(const Signal * dbc_sig, const BitPlan & plan)
+  : sig_def_(dbc_sig),
+    plan_(plan),
+    is_signed_(dbc_sig->isSigned()),
+    value_type_(dbc_sig->getValueType()),
+    factor_(dbc_sig->getFactor()),
+    offset_(dbc_sig->getOffset()),
+    inv_factor_(factor_ != 0.0 ? 1.0 / factor_ : 0.0),
+    raw_min_(0.0),
+    raw_max_(0.0),
+    min_(dbc_sig->getMinVal()),
+    max_(dbc_sig->getMaxVal()),
+    has_range_(min_ < max_),
+    raw_value_(0),
+    active_(true),
+    lookup_values_(nullptr),
+    changed_slots_(nullptr),
+    slot_(0),
+    changed_(false),
+    patchable_(false)
 {
+  unsigned int length = dbc_sig->getLength();
+
+  if (length > 0 && length <= 64) {
+    // Bounds of the raw range, exactly representable as doubles.
+    // raw_max_ is exclusive.
+    if (is_signed_) {
+      raw_min_ = -std::ldexp(1.0, static_cast<int>(length) - 1);
+      raw_max_ = std::ldexp(1.0, static_cast<int>(length) - 1);
+    } else {
+      raw_max_ = std::ldexp(1.0, static_cast<int>(length));
+    }
+  }
+}
+
+const Signal * SignalTranscoder::getSignalDef() const
+{
+  return sig_def_;
+}
+
+int64_t SignalTranscoder::getRawValue() const
+{
+  return static_cast<int64_t>(raw_value_);
+}
+
+double SignalTranscoder::getValue() const
+{
+  return toValue(raw_value_);
+}
+
+bool SignalTranscoder::isActive() const
+{
+  return active_;
+}
+
+void SignalTranscoder::setRawValue(int64_t raw_value)
+{
+  raw_value_ = static_cast<uint64_t>(raw_value);
+  markChanged();
+}
+
+void SignalTranscoder::setValue(double value)
+{
+  raw_value_ = toRaw(value);
+  markChanged();
+}
+
+bool SignalTranscoder::isInRange() const
+{
+  if (!has_range_) {
+    return true;
+  }
+
+  const double value = getValue();
+  return value >= min_ && value <= max_;
+}
+
+void SignalTranscoder::markChanged()
+{
+  if (!changed_ && changed_slots_ != nullptr) {
+    changed_ = true;
+    changed_slots_->push_back(slot_);
+  }
+}
+
+double SignalTranscoder::toValue(uint64_t raw_value) const
+{
+  if (lookup_values_ != nullptr) {
+    return lookup_values_[raw_value & plan_.mask];
+  }
+
+  if (value_type_ != SignalValueType::INTEGER) {
+    return ieeePhysical(value_type_, raw_value, factor_, offset_);
+  }
+
+  double raw = (is_signed_ ?
+    static_cast<double>(static_cast<int64_t>(raw_value)) :
+    static_cast<double>(raw_value));
+
+  return raw * factor_ + offset_;
+}
+
+uint64_t SignalTranscoder::toRaw(double value) const
+{
+  if (value_type_ != SignalValueType::INTEGER) {
+    if (factor_ != 1.0 || offset_ != 0.0) {
+      value = (value - offset_) * inv_factor_;
+    }
+
+    uint64_t raw_value = ieeeBits(value_type_, value);
+
+    // Matches what decoding a signed FLOAT signal extracts
+    if (is_signed_ && value_type_ == SignalValueType::FLOAT) {
+      raw_value = static_cast<uint64_t>(
+        static_cast<int64_t>(static_cast<int32_t>(static_cast<uint32_t>(raw_value))));
+    }
+
+    return raw_value;
+  }
+
+  double raw = std::round((value - offset_) * inv_factor_);
+
+  if (!(raw >= raw_min_)) {
+    // Also catches NaN
+    raw = raw_min_;
+  }
+
+  if (raw >= raw_max_) {
+    return (is_signed_ ?
+      static_cast<uint64_t>(plan_.mask >> 1) :
+      plan_.mask);
+  } else if (is_signed_) {
+    return static_cast<uint64_t>(static_cast<int64_t>(raw));
+  }
+
+  return static_cast<uint64_t>(raw);
+}
+
+uint64_t SignalTranscoder::getClampedRawValue() const
+{
+  const double value = getValue();
+
+  if (!has_range_ || (value >= min_ && value <= max_)) {
+    return raw_value_;
+  }
+
+  // NaN goes to the bottom of the range
+  const double bound = (value > max_ ? max_ : min_);
+  uint64_t raw_value = toRaw(bound);
+
+  if (value_type_ != SignalValueType::INTEGER) {
+    return raw_value;
+  }
+
+  // Rounding to the nearest raw value can land half a step outside
+  // the range, in which case the neighbour towards the range is used
+  const double clamped = toValue(raw_value);
+
+  if (!(clamped >= min_ && clamped <= max_)) {
+    const bool step_up = ((clamped < min_) == (factor_ > 0.0));
+    const uint64_t neighbour = raw_value + (step_up ? 1 : static_cast<uint64_t>(-1));
+    const double current_raw = (is_signed_ ?
+      static_cast<double>(static_cast<int64_t>(raw_value)) :
+      static_cast<double>(raw_value));
+    const double neighbour_raw = (is_signed_ ?
+      static_cast<double>(static_cast<int64_t>(neighbour)) :
+      static_cast<double>(neighbour));
+
+    // Never step past either end of the signal's raw range or wrap
+    if (neighbour_raw >= raw_min_ && neighbour_raw < raw_max_ &&
+      (step_up ? neighbour_raw > current_raw : neighbour_raw < current_raw))
+    {
+      raw_value = neighbour;
+    }
+  }
+
+  return raw_value;
 }
 
 }  // namespace DbcLoader
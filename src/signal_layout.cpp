@@ -0,0 +1,327 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "signal_layout.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+namespace
+{
+
+bool rangesIntersect(
+  const std::vector<std::pair<unsigned int, unsigned int>> & ranges,
+  const std::vector<std::pair<unsigned int, unsigned int>> & other_ranges)
+{
+  for (const auto & range : ranges) {
+    for (const auto & other_range : other_ranges) {
+      if (range.first <= other_range.second && other_range.first <= range.second) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+// Walks from each slot up through the switches selecting it. Slots
+// whose paths meet at one switch with disjoint values are on
+// different pages and never share a frame.
+bool canCoexist(const std::vector<MuxCondition> & conditions, uint32_t slot, uint32_t other_slot)
+{
+  if (conditions.empty()) {
+    return true;
+  }
+
+  // Bounds the walk even if a malformed layout has a switch cycle
+  const size_t max_depth = conditions.size();
+  int path = static_cast<int>(slot);
+
+  for (size_t depth = 0; path >= 0 && depth < max_depth; ++depth) {
+    int other_path = static_cast<int>(other_slot);
+
+    for (size_t other_depth = 0; other_path >= 0 && other_depth < max_depth; ++other_depth) {
+      const MuxCondition & condition = conditions[path];
+      const MuxCondition & other_condition = conditions[other_path];
+
+      if (path != other_path && condition.switch_slot >= 0 &&
+        condition.switch_slot == other_condition.switch_slot)
+      {
+        return rangesIntersect(condition.ranges, other_condition.ranges);
+      }
+
+      other_path = other_condition.switch_slot;
+    }
+
+    path = conditions[path].switch_slot;
+  }
+
+  return true;
+}
+
+// Bits of PayloadBitmap word which lie within length bytes
+uint64_t payloadWordMask(size_t length, size_t word)
+{
+  const size_t bits = length * 8;
+
+  if (bits >= (word + 1) * 64) {
+    return ~0ULL;
+  }
+
+  if (bits <= word * 64) {
+    return 0;
+  }
+
+  return (1ULL << (bits - word * 64)) - 1;
+}
+
+}  // namespace
+
+bool SignalMask::intersects(const SignalMask & other) const
+{
+  if (word == other.word) {
+    return (low & other.low) != 0 || (high & other.high) != 0;
+  } else if (word + 1 == other.word) {
+    return (high & other.low) != 0;
+  } else if (other.word + 1 == word) {
+    return (low & other.high) != 0;
+  }
+
+  return false;
+}
+
+bool SignalLayoutEntry::operator==(const SignalLayoutEntry & other) const
+{
+  return start_bit == other.start_bit &&
+         length == other.length &&
+         endianness == other.endianness &&
+         is_signed == other.is_signed &&
+         value_type == other.value_type &&
+         floatBits(factor) == floatBits(other.factor) &&
+         floatBits(offset) == floatBits(other.offset) &&
+         is_multiplex_def == other.is_multiplex_def &&
+         is_multiplexed == other.is_multiplexed &&
+         multiplex_id == other.multiplex_id;
+}
+
+bool SignalLayoutEntry::operator!=(const SignalLayoutEntry & other) const
+{
+  return !(*this == other);
+}
+
+bool SignalLayoutEntry::operator<(const SignalLayoutEntry & other) const
+{
+  return std::make_tuple(
+    start_bit, length, endianness, is_signed, value_type, floatBits(factor),
+    floatBits(offset), is_multiplex_def, is_multiplexed, multiplex_id) <
+    std::make_tuple(
+    other.start_bit, other.length, other.endianness, other.is_signed, other.value_type,
+    floatBits(other.factor),
+    floatBits(other.offset), other.is_multiplex_def, other.is_multiplexed, other.multiplex_id);
+}
+
+SignalLayout::SignalLayout(
+  std::vector<SignalLayoutEntry> && entries,
+  std::vector<MuxCondition> && mux_conditions)
+  : entries_(std::move(entries)),
+    mux_conditions_(std::move(mux_conditions)),
+    hash_(entries_.size())
+{
+  plans_.reserve(entries_.size());
+
+  for (const auto & entry : entries_) {
+    plans_.emplace_back(entry.start_bit, entry.length, entry.endianness, entry.is_signed);
+
+    hashCombine(hash_, entry.start_bit);
+    hashCombine(hash_, entry.length);
+    hashCombine(hash_, static_cast<size_t>(entry.endianness));
+    hashCombine(hash_, entry.is_signed);
+    hashCombine(hash_, static_cast<size_t>(entry.value_type));
+    hashCombine(hash_, floatBits(entry.factor));
+    hashCombine(hash_, floatBits(entry.offset));
+    hashCombine(hash_, entry.is_multiplex_def);
+    hashCombine(hash_, entry.is_multiplexed);
+    hashCombine(hash_, entry.multiplex_id);
+  }
+
+  if (!mux_conditions_.empty()) {
+    for (const auto & condition : mux_conditions_) {
+      hashCombine(hash_, static_cast<size_t>(condition.switch_slot + 1));
+
+      for (const auto & range : condition.ranges) {
+        hashCombine(hash_, range.first);
+        hashCombine(hash_, range.second);
+      }
+    }
+
+    mux_tree_ = MuxTree(mux_conditions_);
+  }
+
+  buildMasks();
+}
+
+const std::vector<SignalLayoutEntry> & SignalLayout::getEntries() const
+{
+  return entries_;
+}
+
+const std::vector<BitPlan> & SignalLayout::getPlans() const
+{
+  return plans_;
+}
+
+const std::vector<MuxCondition> & SignalLayout::getMuxConditions() const
+{
+  return mux_conditions_;
+}
+
+const MuxTree & SignalLayout::getMuxTree() const
+{
+  return mux_tree_;
+}
+
+const std::vector<SignalMask> & SignalLayout::getSignalMasks() const
+{
+  return masks_;
+}
+
+const PayloadBitmap & SignalLayout::getOccupancy() const
+{
+  return occupancy_;
+}
+
+const std::vector<std::pair<uint32_t, uint32_t>> & SignalLayout::getOverlaps() const
+{
+  return overlaps_;
+}
+
+bool SignalLayout::isOutOfBounds(uint32_t slot, size_t length) const
+{
+  const SignalMask & mask = masks_[slot];
+
+  // Zero-length, too long or past the largest frame
+  if (plans_[slot].mask == 0) {
+    return true;
+  }
+
+  return (mask.low & ~payloadWordMask(length, mask.word)) != 0 ||
+         (mask.high & ~payloadWordMask(length, mask.word + 1)) != 0;
+}
+
+size_t SignalLayout::getHash() const
+{
+  return hash_;
+}
+
+bool SignalLayout::operator==(const SignalLayout & other) const
+{
+  return hash_ == other.hash_ &&
+         entries_ == other.entries_ &&
+         mux_conditions_ == other.mux_conditions_;
+}
+
+void SignalLayout::buildMasks()
+{
+  occupancy_.fill(0);
+  masks_.reserve(plans_.size());
+
+  for (uint32_t slot = 0; slot < plans_.size(); ++slot) {
+    const BitPlan & plan = plans_[slot];
+
+    // Set every bit of the signal and see which payload words it hits
+    PaddedFrame signal_bits;
+    signal_bits.fill(0);
+    plan.insert(signal_bits.data(), plan.mask);
+
+    SignalMask mask{0, 0, 0};
+    uint64_t words[PAYLOAD_WORDS + 1] = {};
+
+    for (size_t word = 0; word < PAYLOAD_WORDS; ++word) {
+      words[word] = loadLe64(signal_bits.data() + FRAME_PADDING + word * 8);
+    }
+
+    for (size_t word = 0; word < PAYLOAD_WORDS; ++word) {
+      if (words[word] != 0) {
+        mask = SignalMask{static_cast<uint32_t>(word), words[word], words[word + 1]};
+        break;
+      }
+    }
+
+    const uint64_t high_occupancy =
+      (mask.word + 1 < PAYLOAD_WORDS ? occupancy_[mask.word + 1] : 0);
+
+    // Only slots landing on bits already taken need comparing pairwise
+    if ((occupancy_[mask.word] & mask.low) != 0 || (high_occupancy & mask.high) != 0) {
+      for (uint32_t other_slot = 0; other_slot < slot; ++other_slot) {
+        if (masks_[other_slot].intersects(mask) &&
+          canCoexist(mux_conditions_, other_slot, slot))
+        {
+          overlaps_.emplace_back(other_slot, slot);
+        }
+      }
+    }
+
+    occupancy_[mask.word] |= mask.low;
+
+    if (mask.word + 1 < PAYLOAD_WORDS) {
+      occupancy_[mask.word + 1] |= mask.high;
+    }
+
+    masks_.push_back(mask);
+  }
+
+  std::sort(overlaps_.begin(), overlaps_.end());
+}
+
+std::shared_ptr<const SignalLayout> SignalLayoutPool::intern(SignalLayout && layout)
+{
+  auto range = layouts_.equal_range(layout.getHash());
+
+  for (auto itr = range.first; itr != range.second; ++itr) {
+    if (*(itr->second) == layout) {
+      return itr->second;
+    }
+  }
+
+  auto shared = std::make_shared<const SignalLayout>(std::move(layout));
+  layouts_.emplace(shared->getHash(), shared);
+
+  return shared;
+}
+
+size_t SignalLayoutPool::size() const
+{
+  return layouts_.size();
+}
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
@@ -0,0 +1,402 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "struct_binding.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+namespace
+{
+
+// Raw values extracted per pass of decode()
+constexpr size_t DECODE_CHUNK = 32;
+
+size_t memberSize(MemberType type)
+{
+  switch (type) {
+    case MemberType::BOOL:
+      return sizeof(bool);
+    case MemberType::UINT8:
+    case MemberType::INT8:
+      return 1;
+    case MemberType::UINT16:
+    case MemberType::INT16:
+      return 2;
+    case MemberType::UINT32:
+    case MemberType::INT32:
+    case MemberType::FLOAT:
+      return 4;
+    case MemberType::UINT64:
+    case MemberType::INT64:
+    case MemberType::DOUBLE:
+      return 8;
+  }
+
+  return 0;
+}
+
+template<typename T>
+void store(uint8_t * member, T value)
+{
+  std::memcpy(member, &value, sizeof(value));
+}
+
+template<typename T>
+T saturateUnsigned(uint64_t value)
+{
+  if (value > static_cast<uint64_t>(std::numeric_limits<T>::max())) {
+    return std::numeric_limits<T>::max();
+  }
+
+  return static_cast<T>(value);
+}
+
+template<typename T>
+T saturateSigned(int64_t value)
+{
+  if (value >= 0) {
+    return saturateUnsigned<T>(static_cast<uint64_t>(value));
+  } else if (!std::numeric_limits<T>::is_signed) {
+    return 0;
+  } else if (value < static_cast<int64_t>(std::numeric_limits<T>::min())) {
+    return std::numeric_limits<T>::min();
+  }
+
+  return static_cast<T>(value);
+}
+
+// Rounds half away from zero like std::round, without the libm call
+// for the 8 to 32 bit types which can go through int64_t
+template<typename T>
+T saturateDouble(double value)
+{
+  // Both limits are exact powers of two (or zero) as doubles
+  const double low = static_cast<double>(std::numeric_limits<T>::min());
+  const double high = std::ldexp(1.0, std::numeric_limits<T>::digits);
+
+  if (std::isnan(value)) {
+    return 0;
+  } else if (value < low) {
+    return std::numeric_limits<T>::min();
+  } else if (value >= high) {
+    return std::numeric_limits<T>::max();
+  }
+
+  if (sizeof(T) == 8) {
+    value = std::round(value);
+    return (value >= high ? std::numeric_limits<T>::max() : static_cast<T>(value));
+  }
+
+  // Exact, since value is within 2^32 of zero
+  int64_t whole = static_cast<int64_t>(value);
+  const double fraction = value - static_cast<double>(whole);
+
+  // Branch-free, halves are common with factors like 0.5
+  whole += static_cast<int64_t>(fraction >= 0.5) - static_cast<int64_t>(fraction <= -0.5);
+
+  // Rounding up can only pass the top of the range
+  return static_cast<T>(std::min<int64_t>(whole, std::numeric_limits<T>::max()));
+}
+
+inline void storeValue(uint8_t * member, MemberType type, double value)
+{
+  switch (type) {
+    case MemberType::BOOL:
+      // NaN compares unequal to everything, so test for non-zero the
+      // other way round to make it false like the other integer types
+      store(member, value < 0.0 || value > 0.0);
+      break;
+    case MemberType::UINT8:
+      store(member, saturateDouble<uint8_t>(value));
+      break;
+    case MemberType::INT8:
+      store(member, saturateDouble<int8_t>(value));
+      break;
+    case MemberType::UINT16:
+      store(member, saturateDouble<uint16_t>(value));
+      break;
+    case MemberType::INT16:
+      store(member, saturateDouble<int16_t>(value));
+      break;
+    case MemberType::UINT32:
+      store(member, saturateDouble<uint32_t>(value));
+      break;
+    case MemberType::INT32:
+      store(member, saturateDouble<int32_t>(value));
+      break;
+    case MemberType::UINT64:
+      store(member, saturateDouble<uint64_t>(value));
+      break;
+    case MemberType::INT64:
+      store(member, saturateDouble<int64_t>(value));
+      break;
+    case MemberType::FLOAT:
+      store(member, static_cast<float>(value));
+      break;
+    case MemberType::DOUBLE:
+      store(member, value);
+      break;
+  }
+}
+
+// raw is sign-extended for signed signals
+template<typename T>
+T saturateRaw(uint64_t raw, bool is_signed)
+{
+  return is_signed ?
+         saturateSigned<T>(static_cast<int64_t>(raw)) :
+         saturateUnsigned<T>(raw);
+}
+
+// Only for integer and bool members
+inline void storeRaw(uint8_t * member, MemberType type, uint64_t raw, bool is_signed)
+{
+  switch (type) {
+    case MemberType::BOOL:
+      store(member, raw != 0);
+      break;
+    case MemberType::UINT8:
+      store(member, saturateRaw<uint8_t>(raw, is_signed));
+      break;
+    case MemberType::INT8:
+      store(member, saturateRaw<int8_t>(raw, is_signed));
+      break;
+    case MemberType::UINT16:
+      store(member, saturateRaw<uint16_t>(raw, is_signed));
+      break;
+    case MemberType::INT16:
+      store(member, saturateRaw<int16_t>(raw, is_signed));
+      break;
+    case MemberType::UINT32:
+      store(member, saturateRaw<uint32_t>(raw, is_signed));
+      break;
+    case MemberType::INT32:
+      store(member, saturateRaw<int32_t>(raw, is_signed));
+      break;
+    case MemberType::UINT64:
+      store(member, saturateRaw<uint64_t>(raw, is_signed));
+      break;
+    case MemberType::INT64:
+      store(member, saturateRaw<int64_t>(raw, is_signed));
+      break;
+    case MemberType::FLOAT:
+    case MemberType::DOUBLE:
+      break;
+  }
+}
+
+// The switch slot a condition depends on, or -1 where MuxTree
+// treats the slot as always present
+int switchOf(const std::vector<MuxCondition> & conditions, size_t slot)
+{
+  int switch_slot = conditions[slot].switch_slot;
+
+  if (switch_slot < 0 ||
+    static_cast<size_t>(switch_slot) >= conditions.size() ||
+    static_cast<size_t>(switch_slot) == slot)
+  {
+    return -1;
+  }
+
+  return switch_slot;
+}
+
+}  // namespace
+
+StructBinding::StructBinding(
+  const MessageCodec & codec,
+  size_t struct_size,
+  const std::vector<MemberBinding> & members)
+  : id_(codec.getId()),
+    length_(codec.getLength()),
+    struct_size_(struct_size)
+{
+  bind(codec, members);
+}
+
+StructBinding::StructBinding(
+  const Message & dbc_msg,
+  size_t struct_size,
+  const std::vector<MemberBinding> & members)
+  : id_(dbc_msg.getId()),
+    length_(dbc_msg.getLength()),
+    struct_size_(struct_size)
+{
+  bind(MessageCodec(dbc_msg), members);
+}
+
+unsigned int StructBinding::getId() const
+{
+  return id_;
+}
+
+size_t StructBinding::getStructSize() const
+{
+  return struct_size_;
+}
+
+size_t StructBinding::getMemberCount() const
+{
+  return entries_.size();
+}
+
+void StructBinding::bind(const MessageCodec & codec, const std::vector<MemberBinding> & members)
+{
+  const SignalLayout * layout = codec.getLayout();
+  const auto & layout_entries = layout->getEntries();
+  const auto & plans = layout->getPlans();
+  const auto & conditions = layout->getMuxConditions();
+
+  plans_.reserve(members.size());
+  entries_.reserve(members.size());
+
+  for (const auto & member : members) {
+    const int slot = codec.getSlot(member.signal_name);
+    const size_t size = memberSize(member.type);
+
+    if (slot < 0 || size == 0 || member.offset > struct_size_ ||
+      struct_size_ - member.offset < size)
+    {
+      throw DbcBindingException();
+    }
+
+    const auto & layout_entry = layout_entries[slot];
+    const bool integer_member =
+      member.type != MemberType::FLOAT && member.type != MemberType::DOUBLE;
+
+    Entry entry{
+      member.offset, member.type, layout_entry.value_type,
+      integer_member && layout_entry.value_type == SignalValueType::INTEGER &&
+      layout_entry.factor == 1.0f && layout_entry.offset == 0.0f,
+      layout_entry.factor, layout_entry.offset,
+      std::vector<Condition>()};
+
+    if (!conditions.empty()) {
+      // Walk up to the root switch. Chains which loop back on
+      // themselves are decoded unconditionally, as MuxTree does.
+      std::vector<Condition> chain;
+      size_t current = static_cast<size_t>(slot);
+
+      for (int switch_slot = switchOf(conditions, current);
+        switch_slot >= 0;
+        switch_slot = switchOf(conditions, current))
+      {
+        if (chain.size() >= conditions.size()) {
+          chain.clear();
+          break;
+        }
+
+        chain.push_back(Condition{plans[switch_slot], conditions[current].ranges});
+        current = static_cast<size_t>(switch_slot);
+      }
+
+      entry.conditions.assign(chain.rbegin(), chain.rend());
+    }
+
+    plans_.push_back(plans[slot]);
+    entries_.push_back(std::move(entry));
+  }
+}
+
+TranscodeErrorType StructBinding::decode(
+  const uint8_t * frame, size_t frame_length, void * object) const
+{
+  if (frame_length < length_) {
+    return TranscodeErrorType::INVALID_LENGTH;
+  }
+
+  PaddedFrame padded_frame;
+  padded_frame.fill(0);
+  std::memcpy(padded_frame.data() + FRAME_PADDING, frame, length_);
+
+  const BitPlanKernels & plan_kernels = getBitPlanKernels();
+  uint8_t * base = static_cast<uint8_t *>(object);
+  int64_t raw_values[DECODE_CHUNK];
+
+  for (size_t first = 0; first < entries_.size(); first += DECODE_CHUNK) {
+    const size_t chunk_count = std::min(DECODE_CHUNK, entries_.size() - first);
+
+    plan_kernels.extractFrame(
+      plans_.data() + first, chunk_count, padded_frame.data(), raw_values);
+
+    for (size_t i = 0; i < chunk_count; ++i) {
+      const Entry & entry = entries_[first + i];
+      uint8_t * member = base + entry.member_offset;
+      bool present = true;
+
+      for (const auto & condition : entry.conditions) {
+        const uint64_t switch_value = condition.plan.extract(padded_frame.data());
+        present = false;
+
+        for (const auto & range : condition.ranges) {
+          if (range.first <= switch_value && switch_value <= range.second) {
+            present = true;
+            break;
+          }
+        }
+
+        if (!present) {
+          break;
+        }
+      }
+
+      if (!present) {
+        std::memset(member, 0, memberSize(entry.type));
+        continue;
+      }
+
+      const uint64_t raw = static_cast<uint64_t>(raw_values[i]);
+      const bool is_signed = plans_[first + i].sign_bit != 0;
+
+      if (entry.identity) {
+        storeRaw(member, entry.type, raw, is_signed);
+      } else if (entry.value_type != SignalValueType::INTEGER) {
+        storeValue(
+          member, entry.type, ieeePhysical(entry.value_type, raw, entry.factor, entry.offset));
+      } else {
+        double raw_double = (is_signed ?
+          static_cast<double>(static_cast<int64_t>(raw)) :
+          static_cast<double>(raw));
+
+        storeValue(member, entry.type, raw_double * entry.factor + entry.offset);
+      }
+    }
+  }
+
+  return TranscodeErrorType::NONE;
+}
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS
@@ -0,0 +1,343 @@
+// Copyright (c) 2019 AutonomouStuff, LLC
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "versioned_database.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace AS
+{
+namespace CAN
+{
+namespace DbcLoader
+{
+
+// Begin DatabaseSnapshot
+
+uint64_t DatabaseSnapshot::getRevision() const
+{
+  return revision_;
+}
+
+std::string DatabaseSnapshot::getVersion() const
+{
+  return version_;
+}
+
+std::string DatabaseSnapshot::getBusConfig() const
+{
+  return bus_config_;
+}
+
+std::vector<const BusNode *> DatabaseSnapshot::getBusNodes() const
+{
+  std::vector<const BusNode *> nodes;
+
+  for (auto & node : *bus_nodes_) {
+    nodes.emplace_back(&node);
+  }
+
+  return nodes;
+}
+
+const Message * DatabaseSnapshot::getMessage(unsigned int id) const
+{
+  auto msg_itr = messages_.find(id);
+
+  if (msg_itr != messages_.end()) {
+    return msg_itr->second.get();
+  }
+
+  return nullptr;
+}
+
+std::unordered_map<unsigned int, const Message *> DatabaseSnapshot::getMessages() const
+{
+  std::unordered_map<unsigned int, const Message *> msgs;
+
+  for (auto & msg : messages_) {
+    msgs[msg.first] = msg.second.get();
+  }
+
+  return msgs;
+}
+
+const MessageCodec * DatabaseSnapshot::getCodec(unsigned int id) const
+{
+  auto codec_itr = codecs_.find(id);
+
+  if (codec_itr != codecs_.end()) {
+    return codec_itr->second.get();
+  }
+
+  return nullptr;
+}
+
+std::vector<const Attribute *> DatabaseSnapshot::getAttributeDefinitions() const
+{
+  std::vector<const Attribute *> attr_defs;
+
+  for (auto & attr : *attribute_defs_) {
+    attr_defs.emplace_back(attr.get());
+  }
+
+  return attr_defs;
+}
+
+// End DatabaseSnapshot
+// Begin DatabaseTransaction
+
+DatabaseTransaction::DatabaseTransaction(
+  VersionedDatabase * db,
+  std::shared_ptr<const DatabaseSnapshot> && base)
+  : db_(db),
+    base_(std::move(base)),
+    committed_(false)
+{
+}
+
+void DatabaseTransaction::putMessage(Message && msg)
+{
+  unsigned int id = msg.getId();
+  auto staged_itr = staged_.find(id);
+
+  if (staged_itr == staged_.end()) {
+    auto base_itr = base_->messages_.find(id);
+    StagedMessage staged_msg;
+
+    if (base_itr != base_->messages_.end()) {
+      staged_msg.base = base_itr->second;
+    }
+
+    staged_itr = staged_.emplace(id, std::move(staged_msg)).first;
+  }
+
+  staged_itr->second.edited = std::make_shared<Message>(std::move(msg));
+}
+
+void DatabaseTransaction::removeMessage(unsigned int msg_id)
+{
+  // Throws if the message doesn't exist
+  stage(msg_id);
+  staged_[msg_id].edited = nullptr;
+}
+
+void DatabaseTransaction::putSignal(unsigned int msg_id, Signal && sig)
+{
+  auto & msg = stage(msg_id);
+  std::string sig_name = sig.getName();
+
+  msg.signals_.erase(sig_name);
+  msg.signals_.emplace(std::move(sig_name), std::move(sig));
+  relayout(msg);
+}
+
+void DatabaseTransaction::removeSignal(unsigned int msg_id, const std::string & sig_name)
+{
+  auto & msg = stage(msg_id);
+
+  if (msg.signals_.erase(sig_name) == 0) {
+    throw DbcEditException();
+  }
+
+  relayout(msg);
+}
+
+void DatabaseTransaction::setMessageAttribute(
+  unsigned int msg_id,
+  const std::string & attr_name,
+  std::string && value)
+{
+  auto & msg = stage(msg_id);
+  msg.attribute_values_[attr_name] = std::move(value);
+}
+
+void DatabaseTransaction::setSignalAttribute(
+  unsigned int msg_id,
+  const std::string & sig_name,
+  const std::string & attr_name,
+  std::string && value)
+{
+  auto & msg = stage(msg_id);
+  auto sig_itr = msg.signals_.find(sig_name);
+
+  if (sig_itr == msg.signals_.end()) {
+    throw DbcEditException();
+  }
+
+  sig_itr->second.attribute_values_[attr_name] = std::move(value);
+}
+
+const Message * DatabaseTransaction::getMessage(unsigned int msg_id) const
+{
+  auto staged_itr = staged_.find(msg_id);
+
+  if (staged_itr != staged_.end()) {
+    return staged_itr->second.edited.get();
+  }
+
+  return base_->getMessage(msg_id);
+}
+
+std::shared_ptr<const DatabaseSnapshot> DatabaseTransaction::commit()
+{
+  if (committed_) {
+    throw DbcEditException();
+  }
+
+  std::lock_guard<std::mutex> lock(db_->commit_mutex_);
+  auto head = std::atomic_load(&(db_->head_));
+
+  // Every message this transaction touched must still be the
+  // version it was copied from, otherwise another writer got there first.
+  for (const auto & staged_msg : staged_) {
+    auto head_itr = head->messages_.find(staged_msg.first);
+    const Message * head_msg =
+      (head_itr != head->messages_.end() ? head_itr->second.get() : nullptr);
+
+    if (head_msg != staged_msg.second.base.get()) {
+      throw DbcCommitConflictException();
+    }
+  }
+
+  // Every edited message is rebuilt before anything is moved out of
+  // staged_, so one which fails validation leaves the transaction
+  // intact and it can be fixed and committed again
+  std::unordered_map<unsigned int, std::shared_ptr<const MessageCodec>> codecs;
+
+  for (auto & staged_msg : staged_) {
+    auto & edited = staged_msg.second.edited;
+
+    if (edited) {
+      edited->layout_ = db_->layout_pool_.intern(edited->buildLayout());
+      edited->updateHashes();
+      edited->buildTemplate(*(head->attribute_defs_));
+      edited->loadE2EConfig(*(head->attribute_defs_));
+      codecs[staged_msg.first] = std::make_shared<const MessageCodec>(*edited);
+    }
+  }
+
+  auto next = std::make_shared<DatabaseSnapshot>(*head);
+  next->revision_ = head->revision_ + 1;
+
+  for (auto & staged_msg : staged_) {
+    auto & edited = staged_msg.second.edited;
+
+    if (edited) {
+      next->codecs_[staged_msg.first] = std::move(codecs[staged_msg.first]);
+      next->messages_[staged_msg.first] = std::move(edited);
+    } else {
+      next->messages_.erase(staged_msg.first);
+      next->codecs_.erase(staged_msg.first);
+    }
+  }
+
+  std::shared_ptr<const DatabaseSnapshot> published = std::move(next);
+  std::atomic_store(&(db_->head_), published);
+
+  staged_.clear();
+  committed_ = true;
+
+  return published;
+}
+
+Message & DatabaseTransaction::stage(unsigned int msg_id)
+{
+  auto staged_itr = staged_.find(msg_id);
+
+  if (staged_itr == staged_.end()) {
+    auto base_itr = base_->messages_.find(msg_id);
+
+    if (base_itr == base_->messages_.end()) {
+      throw DbcEditException();
+    }
+
+    // Copy-on-write: only messages which are edited get duplicated
+    StagedMessage staged_msg;
+    staged_msg.base = base_itr->second;
+    staged_msg.edited = std::make_shared<Message>(*(base_itr->second));
+    staged_itr = staged_.emplace(msg_id, std::move(staged_msg)).first;
+  } else if (!staged_itr->second.edited) {
+    // Removed earlier in this transaction
+    throw DbcEditException();
+  }
+
+  return *(staged_itr->second.edited);
+}
+
+void DatabaseTransaction::relayout(Message & msg)
+{
+  // A private layout until commit() interns it
+  msg.layout_ = std::make_shared<const SignalLayout>(msg.buildLayout());
+  msg.updateHashes();
+  msg.buildTemplate(*(base_->attribute_defs_));
+}
+
+// End DatabaseTransaction
+// Begin VersionedDatabase
+
+VersionedDatabase::VersionedDatabase(Database && dbc)
+{
+  auto initial = std::make_shared<DatabaseSnapshot>();
+
+  initial->revision_ = 0;
+  initial->version_ = std::move(dbc.version_);
+  initial->bus_config_ = std::move(dbc.bus_config_);
+  initial->bus_nodes_ =
+    std::make_shared<const std::vector<BusNode>>(std::move(dbc.bus_nodes_));
+  initial->attribute_defs_ =
+    std::make_shared<const std::vector<std::unique_ptr<Attribute>>>(std::move(dbc.attribute_defs_));
+
+  for (auto & msg : dbc.messages_) {
+    auto shared_msg = std::make_shared<Message>(std::move(msg.second));
+    shared_msg->layout_ = layout_pool_.intern(shared_msg->buildLayout());
+    shared_msg->updateHashes();
+    shared_msg->buildTemplate(*(initial->attribute_defs_));
+    shared_msg->loadE2EConfig(*(initial->attribute_defs_));
+    initial->codecs_.emplace(msg.first, std::make_shared<const MessageCodec>(*shared_msg));
+    initial->messages_.emplace(msg.first, std::move(shared_msg));
+  }
+
+  dbc.messages_.clear();
+  head_ = std::move(initial);
+}
+
+std::shared_ptr<const DatabaseSnapshot> VersionedDatabase::snapshot() const
+{
+  return std::atomic_load(&head_);
+}
+
+DatabaseTransaction VersionedDatabase::beginTransaction()
+{
+  return DatabaseTransaction(this, snapshot());
+}
+
+// End VersionedDatabase
+
+}  // namespace DbcLoader
+}  // namespace CAN
+}  // namespace AS